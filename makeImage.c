@@ -5,8 +5,10 @@
 #include <unistd.h>
 #include <stdint.h>
 #include <errno.h>
+#include <stdbool.h>
 
 #include "./src/kernel/fileSystem/fs.h"
+#include "./src/kernel/fileSystem/blockBitmap.h"
 
 #define SECTOR_SIZE 512
 #define TOTAL_IMAGE_SIZE 1.44 * 1000 * 1000 // Lets try with a floppy disk size
@@ -23,18 +25,35 @@ struct file {
   char name[60];
   uint8_t fd;
   uint32_t size;
+  uint32_t firstBlock; // First data block, allocated by allocateDataBlocks
 };
 
-struct file outputImage = { "build/bin/image.img", 0, 0 };
+struct file outputImage = { "build/bin/image.img", 0, 0, 0 };
 
 struct file files[] = {
-  { "build/bin/bootsector", 0, 0 },
-  { "build/bin/prekernel", 0, 0 },
-  { "build/bin/kernel", 0, 0 },
+  { "build/bin/bootsector", 0, 0, 0 },
+  { "build/bin/prekernel", 0, 0, 0 },
+  { "build/bin/kernel", 0, 0, 0 },
 };
 
 uint32_t numberOfFiles = sizeof(files) / sizeof(struct file);
 
+struct directoryEntry rootDirectoryEntries[] = {
+  { "bootsector", 2 },
+  { "prekernel", 3 },
+  { "kernel", 4 },
+};
+
+uint32_t numberOfRootDirectoryEntries = sizeof(rootDirectoryEntries) / sizeof(struct directoryEntry);
+
+// Root directory data as written to the image, flat or hashed (see fs.h)
+uint8_t *rootDirectoryData;
+uint32_t rootDirectorySize;
+uint8_t rootDirectoryFlags;
+uint32_t rootDirectoryFirstBlock;
+
+uint8_t *dataBlocksBitmap;
+
 // We'll have numberOfFiles + 2 inodes
 // inode 0 will be invalid
 // inode 1 will be the root directory
@@ -67,6 +86,79 @@ int sectorsToBytes(int sectors) {
 }
 
 
+/*
+ * Lay out the given entries as a directory
+ * Entries fitting in a single block are kept as a flat array, readable by the prekernel
+ * Otherwise they're hashed into buckets of one block each, the bucket count grows until no bucket overflows
+ * and the directory is mapped with an extent
+ */
+uint8_t *buildDirectory(struct directoryEntry *entries, uint32_t count, uint32_t *size, uint8_t *flags) {
+  if (count <= DIRECTORY_ENTRIES_PER_BLOCK) {
+    *size = count * sizeof(struct directoryEntry);
+    *flags = 0;
+
+    uint8_t *data = (uint8_t *)malloc(*size);
+    memcpy(data, entries, *size);
+    return data;
+  }
+
+  // Aim at buckets 3/4 full
+  uint32_t buckets = ceilDiv(count * 4, DIRECTORY_ENTRIES_PER_BLOCK * 3);
+
+  for (;;) {
+    uint8_t *data = (uint8_t *)calloc(1 + buckets, BLOCK_SIZE);
+    struct directoryIndex *index = (struct directoryIndex *)data;
+    bool overflow = false;
+
+    index->magic = DIRECTORY_INDEX_MAGIC;
+    index->buckets = buckets;
+    index->entries = count;
+
+    for (uint32_t i = 0; i < count && !overflow; i++) {
+      uint32_t hash = directoryNameHash(entries[i].name, strnlen(entries[i].name, DIRECTORY_ENTRY_NAME_LENGTH));
+      struct directoryEntry *bucket = (struct directoryEntry *)(data + (1 + hash % buckets) * BLOCK_SIZE);
+
+      uint32_t slot = 0;
+      while (slot < DIRECTORY_ENTRIES_PER_BLOCK && bucket[slot].inodeNumber) slot++;
+
+      if (slot == DIRECTORY_ENTRIES_PER_BLOCK) overflow = true;
+      else bucket[slot] = entries[i];
+    }
+
+    if (!overflow) {
+      *size = (1 + buckets) * BLOCK_SIZE;
+      *flags = INODE_FLAG_HASHED_DIRECTORY;
+      return data;
+    }
+
+    free(data);
+    buckets++;
+  }
+}
+
+/*
+ * Map the 'blocks' contiguous blocks starting at 'startBlock' with a single extent, in the inode itself
+ */
+void setExtent(struct inode *inode, uint32_t startBlock, uint32_t blocks) {
+  // Built in aligned storage, the root isn't aligned in the packed inode
+  uint32_t root[INODE_DIRECT_BLOCKS];
+  struct extentHeader *header = (struct extentHeader *)root;
+  struct extent *extent = (struct extent *)(header + 1);
+
+  memset(root, 0x0, sizeof(root));
+  header->magic = EXTENT_MAGIC;
+  header->entries = blocks ? 1 : 0;
+  header->maxEntries = INODE_EXTENTS;
+  header->depth = 0;
+
+  extent->fileBlock = 0;
+  extent->startBlock = startBlock;
+  extent->length = blocks;
+
+  memcpy(inode->extentRoot, root, sizeof(root));
+  inode->flags |= INODE_FLAG_EXTENTS;
+}
+
 void openFiles() {
   for (int i = 0; i < numberOfFiles; i++) 
     files[i].fd = open(files[i].name, O_RDONLY);
@@ -140,11 +232,33 @@ void writeInodesBitmap() {
   write(outputImage.fd, inodesBitmap, inodesBitmapBytes);
 }
 
-void writeDataBlocksBitmap() {
-  int dataBlocksBitmapBlocks = ceilDiv(TOTAL_NUMBER_OF_DATA_BLOCKS, BLOCK_SIZE * 8); // * 8: each byte holds 8 inodes
-  int dataBlocksBitmapBytes = dataBlocksBitmapBlocks * BLOCK_SIZE;
-  uint8_t *dataBlocksBitmap= (uint8_t *)malloc(dataBlocksBitmapBytes);
-  memset(dataBlocksBitmap, 0x0, dataBlocksBitmapBytes);
+/*
+ * Allocate 'blocks' contiguous blocks near 'goal', files are mapped with a single extent
+ */
+uint32_t allocateContiguous(uint32_t goal, uint32_t blocks) {
+  if (!blocks) return 0;
+
+  uint32_t length;
+  uint32_t first = blockBitmapFindRun(dataBlocksBitmap, superBlock.firstDataBlock, superBlock.totalNumberOfDataBlocks, goal, blocks, &length);
+
+  if (length < blocks) {
+    printf("Not enough contiguous data blocks: %d needed\n", blocks);
+    exit(1);
+  }
+
+  blockBitmapSet(dataBlocksBitmap, first, blocks);
+  return first;
+}
+
+/*
+ * Mark the reserved blocks as used and allocate the blocks of the root directory and of the files
+ * through the data blocks bitmap, the same way the kernel allocates them
+ * Everything lives in the root directory, so the allocation starts at the root directory locality group
+ * and every file is placed right after the previous one
+ */
+void allocateDataBlocks() {
+  int dataBlocksBitmapBytes = superBlock.dataBlocksBitmapBlocks * BLOCK_SIZE;
+  dataBlocksBitmap = (uint8_t *)calloc(dataBlocksBitmapBytes, 1);
 
   // Data block 0 -> bootsector
   // Data block 1 -> superblock
@@ -152,28 +266,29 @@ void writeDataBlocksBitmap() {
   // Data block 3 -> data blocks bitmap
   // Data block 4 -> inodes (see superblock to get the amount of blocks for inodes)
   int reservedDataBlocks = superBlock.firstDataBlock;
-  int rootDirectoryBlocks = ceilDiv(numberOfFiles * sizeof(struct directoryEntry), BLOCK_SIZE);
+  blockBitmapSet(dataBlocksBitmap, 0, reservedDataBlocks);
+
+  uint32_t goal = blockGroupGoal(superBlock.firstDataBlock, superBlock.totalNumberOfDataBlocks, ROOT_DIRECTORY_INODE);
+  int rootDirectoryBlocks = bytesToBlocks(rootDirectorySize);
+  rootDirectoryFirstBlock = allocateContiguous(goal, rootDirectoryBlocks);
+  goal = rootDirectoryFirstBlock + rootDirectoryBlocks;
 
   int filesBlocks = 0;
   // Starting from 1 for ignoring bootsector (already taken into account)
   for (int i = 1; i < numberOfFiles; i++) {
+    files[i].firstBlock = allocateContiguous(goal, bytesToBlocks(files[i].size));
+    goal = files[i].firstBlock + bytesToBlocks(files[i].size);
     filesBlocks += bytesToBlocks(files[i].size);
   }
 
-  int totalUsedDataBlocks = reservedDataBlocks + rootDirectoryBlocks + filesBlocks;
   printf("Reserved data blocks: %d\n", reservedDataBlocks);
-  printf("Root directory data blocks: %d\n", rootDirectoryBlocks);
+  printf("Root directory data blocks: %d (first: %d)\n", rootDirectoryBlocks, rootDirectoryFirstBlock);
   printf("Files data blocks: %d\n", filesBlocks);
-  printf("Total data blocks: %d\n", totalUsedDataBlocks);
-
-  int byte = 0;
-  for (int i = 0; i < totalUsedDataBlocks; i++) {
-    if (i != 0) byte += i % 8 == 0 ? 1 : 0;
-     
-    dataBlocksBitmap[byte] |= 1 << (i % 8);
-  }
+  printf("Total data blocks: %d\n", reservedDataBlocks + rootDirectoryBlocks + filesBlocks);
+}
 
-  write(outputImage.fd, dataBlocksBitmap, dataBlocksBitmapBytes);
+void writeDataBlocksBitmap() {
+  write(outputImage.fd, dataBlocksBitmap, superBlock.dataBlocksBitmapBlocks * BLOCK_SIZE);
 }
 
 void writeInodes() {
@@ -189,15 +304,19 @@ void writeInodes() {
     .referenceCounter = 1,
     .directDataBlocks = { 0 },
     .type = FILETYPE_DIRECTORY,
-    // By now we have 3 files (bootsector.bin, prekernel.bin and kernel.bin)
-    .sizeInBytes = (uint32_t)(numberOfFiles * sizeof(struct directoryEntry)), 
-    .sizeInSectors = (uint32_t)ceilDiv(numberOfFiles * sizeof(struct directoryEntry), SECTOR_SIZE),
+    .sizeInBytes = rootDirectorySize,
+    .sizeInSectors = (uint32_t)ceilDiv(rootDirectorySize, SECTOR_SIZE),
+    .flags = rootDirectoryFlags,
   };
 
   // Point inode to the data blocks
-  int nextDataBlock = superBlock.firstDataBlock;
-  for (int i = 0; i < bytesToBlocks(inodes[1].sizeInBytes); nextDataBlock++, i++) {
-    inodes[1].directDataBlocks[i] = nextDataBlock;
+  // A flat root directory keeps direct blocks, the prekernel reads it
+  if (rootDirectoryFlags & INODE_FLAG_HASHED_DIRECTORY) {
+    setExtent(&inodes[1], rootDirectoryFirstBlock, bytesToBlocks(inodes[1].sizeInBytes));
+  } else {
+    for (int i = 0; i < bytesToBlocks(inodes[1].sizeInBytes); i++) {
+      inodes[1].directDataBlocks[i] = rootDirectoryFirstBlock + i;
+    }
   }
 
   // inode 0 -> invalid
@@ -214,12 +333,9 @@ void writeInodes() {
       .sizeInSectors = (uint32_t)ceilDiv(files[i].size, SECTOR_SIZE),
     };
 
-    // Set the datablocks used for each file
+    // Set the datablocks used for each file, files are allocated contiguously so a single extent maps them
     // Ignore bootsector file since it is in block 0
-    if (i != 0) 
-      for (int j = 0; j < bytesToBlocks(inodes[nextInodeNumber].sizeInBytes); nextDataBlock++, j++) {
-        inodes[nextInodeNumber].directDataBlocks[j] = nextDataBlock;
-      }
+    if (i != 0) setExtent(&inodes[nextInodeNumber], files[i].firstBlock, bytesToBlocks(inodes[nextInodeNumber].sizeInBytes));
 
     nextInodeNumber++;
   }
@@ -254,22 +370,18 @@ void writeBinaryToImg(struct file file) {
 }
 
 void writeDataBlocks() {
-  int nextDataBlock = superBlock.firstDataBlock; 
-
   // Write the root directory data
-  struct directoryEntry entries[] = {
-    { "bootsector", 2 },
-    { "prekernel", 3 },
-    { "kernel", 4 },
-  };
-  printf("Size of root directory: %lu\n", sizeof(entries));
-  write(outputImage.fd, entries, sizeof(entries));
-  int remainingBytes = BLOCK_SIZE - (sizeof(entries) % BLOCK_SIZE);
+  lseek(outputImage.fd, rootDirectoryFirstBlock * BLOCK_SIZE, SEEK_SET);
+  printf("Size of root directory: %u%s\n", rootDirectorySize, rootDirectoryFlags & INODE_FLAG_HASHED_DIRECTORY ? " (hashed)" : "");
+  write(outputImage.fd, rootDirectoryData, rootDirectorySize);
+  int remainingBytes = (BLOCK_SIZE - (rootDirectorySize % BLOCK_SIZE)) % BLOCK_SIZE;
   fillRemainingBytes(remainingBytes);
 
   // Ignore bootsector, since it's already in the img
-  for (int i = 1; i < numberOfFiles; i++)
+  for (int i = 1; i < numberOfFiles; i++) {
+    lseek(outputImage.fd, files[i].firstBlock * BLOCK_SIZE, SEEK_SET);
     writeBinaryToImg(files[i]);
+  }
 
 }
 
@@ -281,6 +393,7 @@ int main() {
   printf("Creating chaOS image\n");
 
   numberOfInodes = numberOfFiles + 2;
+  rootDirectoryData = buildDirectory(rootDirectoryEntries, numberOfRootDirectoryEntries, &rootDirectorySize, &rootDirectoryFlags);
 
   openFiles();
 
@@ -306,6 +419,8 @@ int main() {
   writeSuperBlock();
   printCurrentImgPosition();
   
+  allocateDataBlocks();
+
   printf("Writing inodes bitmap to img...\n");
   writeInodesBitmap();
   printCurrentImgPosition();
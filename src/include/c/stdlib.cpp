@@ -4,11 +4,11 @@
 void *malloc(int32_t size) {
   void *ptr = 0x0;
 
-  asm volatile("int $0x80" : "=d"(ptr) : "a"(SYSCALL_MALLOC), "b"(size));
+  asm volatile("int $0x80" : "=a"(ptr) : "a"(SYSCALL_MALLOC), "b"(size) : "edx", "memory");
 
   return ptr;
 }
 
 void free(void *ptr) {
-  asm volatile("int $0x80" : : "a"(SYSCALL_FREE), "b"(ptr));
+  asm volatile("int $0x80" : : "a"(SYSCALL_FREE), "b"(ptr) : "edx", "memory");
 }
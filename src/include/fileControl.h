@@ -0,0 +1,12 @@
+#pragma once
+
+/*
+ * Commands of fcntl
+ */
+#define FCNTL_GET_FLAGS 1 // Returns the flags of the file descriptor
+#define FCNTL_SET_FLAGS 2 // Replaces them with the given ones
+
+/*
+ * Flags of an open file descriptor, shared by the file descriptors dup'ed from it
+ */
+#define FCNTL_NON_BLOCKING 0x1 // Reads return 0 right away instead of waiting for data
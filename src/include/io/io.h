@@ -3,9 +3,38 @@
 
 /* Ports */
 #define DISK_PORT_BASE 0x1F0 // For primary disk, 0x170 for secondary
+#define DISK_CONTROL_PORT 0x3F6 // Device control register for primary disk, 0x376 for secondary
 
 /* Commands */
-#define DISK_READ_CMD 0x20
+#define DISK_READ_CMD           0x20
+#define DISK_WRITE_CMD          0x30
+#define DISK_READ_MULTIPLE_CMD  0xC4 // Read sectors, one DRQ block (several sectors) per interrupt
+#define DISK_WRITE_MULTIPLE_CMD 0xC5 // Write sectors, one DRQ block (several sectors) per interrupt
+#define DISK_SET_MULTIPLE_CMD   0xC6 // Set the number of sectors per DRQ block for READ/WRITE MULTIPLE
+#define DISK_READ_DMA_CMD       0xC8 // Read sectors using the bus master DMA
+#define DISK_WRITE_DMA_CMD      0xCA // Write sectors using the bus master DMA
+#define DISK_IDENTIFY_CMD       0xEC
+
+/* Status register bits */
+#define DISK_STATUS_ERR  0x01 // An error occurred
+#define DISK_STATUS_DRQ  0x08 // Data ready to be transferred
+#define DISK_STATUS_DRDY 0x40 // Drive ready
+#define DISK_STATUS_BSY  0x80 // Drive busy
+
+/* Bus master IDE registers, offsets from the bus master base (BAR4 of the IDE controller) for the primary channel */
+#define BUS_MASTER_COMMAND 0x0
+#define BUS_MASTER_STATUS  0x2
+#define BUS_MASTER_PRDT    0x4 // Physical address of the PRD table
+
+#define BUS_MASTER_COMMAND_START 0x1
+#define BUS_MASTER_COMMAND_READ  0x8 // Direction: the device writes into memory
+
+#define BUS_MASTER_STATUS_ACTIVE    0x1
+#define BUS_MASTER_STATUS_ERROR     0x2
+#define BUS_MASTER_STATUS_INTERRUPT 0x4
+
+/* A single command can transfer up to 256 sectors (sector count 0 means 256) */
+#define DISK_MAX_SECTORS_PER_COMMAND 256
 
 namespace IO {
 
@@ -20,6 +49,28 @@ static inline void outb(uint16_t port, uint8_t data) {
   asm volatile("out %0,%1" : : "a" (data), "d" (port));
 }
 
+static inline uint16_t inw(uint16_t port) {
+  uint16_t data;
+
+  asm volatile("in %1,%0" : "=a" (data) : "d" (port));
+  return data;
+}
+
+static inline void outw(uint16_t port, uint16_t data) {
+  asm volatile("out %0,%1" : : "a" (data), "d" (port));
+}
+
+static inline uint32_t inl(uint16_t port) {
+  uint32_t data;
+
+  asm volatile("in %1,%0" : "=a" (data) : "d" (port));
+  return data;
+}
+
+static inline void outl(uint16_t port, uint32_t data) {
+  asm volatile("out %0,%1" : : "a" (data), "d" (port));
+}
+
 /*
  * Performs the input operation from the given port to the given address
  * 'count' times.
@@ -39,6 +90,17 @@ static inline void insl(int port, void *address, int count) {
                "memory", "cc");
 }
 
+/*
+ * Performs the output operation from the given address to the given port 'count' times (32 bits each time)
+ * Counterpart of 'insl'
+ */
+static inline void outsl(int port, const void *address, int count) {
+  asm volatile("cld; rep outsl" :
+               "=S" (address), "=c" (count) :
+               "d" (port), "0" (address), "1" (count) :
+               "cc");
+}
+
 /*
  * Fill 'count' words with 'data' starting from 'address'
  */
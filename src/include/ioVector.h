@@ -0,0 +1,11 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * One of the buffers of a vectored read or write
+ */
+typedef struct {
+  uint8_t *base;
+  size_t length;
+} IOVector;
@@ -10,6 +10,20 @@ void *P2V(void *pa) {
   return (uint8_t *)pa + KERNEL_BASE;
 }
 
+uint32_t physicalAddressOf(void *address) {
+  if ((uint32_t)address >= KERNEL_BASE) return (uint32_t)V2P(address);
+
+  return (uint32_t)address;
+}
+
+bool isLinearMapped(const void *address, uint32_t size) {
+  uint32_t start = (uint32_t)address;
+
+  if (start >= KERNEL_BASE) return size <= KERNEL_LINEAR_SIZE && start - KERNEL_BASE <= KERNEL_LINEAR_SIZE - size;
+
+  return size <= LOW_MEMORY_SIZE && start <= LOW_MEMORY_SIZE - size;
+}
+
 uint32_t ALIGN_ADDRESS_UP(uint32_t address) {
   return (address + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
 }
@@ -4,6 +4,12 @@
 #define KERNEL_BASE 0xC0000000 // 3 GiB
 #define IO_SPACE    0x100000 
 #define PHYSICAL_STOP 0xE000000 // Total physical memory - 224 MiB
+#define DEVICE_MEMORY_BASE 0xF0000000 // Kernel virtual window for memory mapped device registers
+#define DEVICE_MEMORY_SIZE 0x1000000 // 16 MiB
+#define FILE_MAPPING_BASE 0x40000000 // Window for memory mapped files, pages are mapped on the first access
+#define FILE_MAPPING_SIZE 0x10000000 // 256 MiB
+#define KERNEL_LINEAR_SIZE 0x800000 // Physical memory mapped at KERNEL_BASE at boot (8 MiB)
+#define LOW_MEMORY_SIZE 0x100000 // Identity mapped and never remapped (boot stack)
 
 /*
  * Convert the given virtual address to physical address
@@ -20,6 +26,19 @@ void *V2P(void *va);
  */
 void *P2V(void *pa);
 
+/*
+ * Physical address of the given address, as seen by devices doing DMA
+ * Kernel addresses (above KERNEL_BASE) are converted, low addresses are identity mapped
+ */
+uint32_t physicalAddressOf(void *address);
+
+/*
+ * Whether physicalAddressOf gives the right physical address for every byte of the buffer:
+ * it's in the kernel linear map or in low memory
+ * Other addresses (the user heap, mapped files) are backed by frames anywhere and can't be handed to a device
+ */
+bool isLinearMapped(const void *address, uint32_t size);
+
 /* 
  * Align up the given address
  * @param {uint32_t} address - The address we want to align up
@@ -4,6 +4,7 @@
 #include <mem.h>
 #include <string.h>
 #include <stdio.h>
+#include <memLayout.h>
 
 /*
  * Used to map a predefined virtual address to any physical address 
@@ -106,6 +107,10 @@ PageTable *quickmapPageTable(PageTable *pageTable) {
 }
 
 VirtualAddress mapPage(VirtualAddress virtualAddress, PhysicalAddress physicalAddress) {
+  return mapPageWithAttributes(virtualAddress, physicalAddress, PTE_READ_WRITE);
+}
+
+VirtualAddress mapPageWithAttributes(VirtualAddress virtualAddress, PhysicalAddress physicalAddress, uint32_t attributes) {
   PageDirectory *currentPageDirectory = quickmapPageDirectory(getPageDirectory());
 
   PageDirectoryEntry *pageDirectoryEntry = &currentPageDirectory->entries[getPageDirectoryIndex(virtualAddress)];
@@ -126,10 +131,15 @@ VirtualAddress mapPage(VirtualAddress virtualAddress, PhysicalAddress physicalAd
     printf("\nEntered here - page Table: %lx, v address: %lx, getPageTableIndex: %lx", pageTable, allocatedBlock, getPageTableIndex(virtualAddress));
   }
 
+  // User pages must be allowed by the page directory entry too,
+  // the page table entry is what decides whether the page is writable
+  if (attributes & PTE_USER) setAttribute(pageDirectoryEntry, PTE_USER);
+
   PageTableEntry *pageTableEntry = &pageTable->entries[getPageTableIndex(virtualAddress)];
 
+  *pageTableEntry = 0;
   setAttribute(pageTableEntry, PTE_PRESENT);
-  setAttribute(pageTableEntry, PTE_READ_WRITE);
+  setAttribute(pageTableEntry, (PAGE_TABLE_FLAGS)attributes);
   setPhysicalFrame(pageTableEntry, physicalAddress);
 
   reloadCR3();
@@ -137,6 +147,40 @@ VirtualAddress mapPage(VirtualAddress virtualAddress, PhysicalAddress physicalAd
   return virtualAddress;
 }
 
+void unmapPage(VirtualAddress virtualAddress) {
+  PageDirectory *currentPageDirectory = quickmapPageDirectory(getPageDirectory());
+
+  PageDirectoryEntry *pageDirectoryEntry = &currentPageDirectory->entries[getPageDirectoryIndex(virtualAddress)];
+  PageTable *pageTable = getPagePhysicalAddress(pageDirectoryEntry);
+
+  if (!pageTable) return;
+
+  pageTable = quickmapPageTable(pageTable);
+  pageTable->entries[getPageTableIndex(virtualAddress)] = 0;
+
+  asm volatile("invlpg (%0)" : : "r" (virtualAddress) : "memory");
+}
+
+VirtualAddress mapDeviceMemory(PhysicalAddress physicalAddress, uint32_t size) {
+  // Next free page of the device memory window, device mappings are never released
+  static VirtualAddress nextDeviceMemoryAddress = DEVICE_MEMORY_BASE;
+
+  uint32_t offset = physicalAddress & (PAGE_SIZE - 1);
+  uint32_t pages = (offset + size + PAGE_SIZE - 1) / PAGE_SIZE;
+
+  if (nextDeviceMemoryAddress + pages * PAGE_SIZE > DEVICE_MEMORY_BASE + DEVICE_MEMORY_SIZE) return 0;
+
+  VirtualAddress virtualAddress = nextDeviceMemoryAddress;
+  nextDeviceMemoryAddress += pages * PAGE_SIZE;
+
+  for (uint32_t i = 0; i < pages; i++)
+    mapPageWithAttributes(virtualAddress + i * PAGE_SIZE,
+                          (physicalAddress - offset) + i * PAGE_SIZE,
+                          PTE_READ_WRITE | PTE_CACHE_DISABLE | PTE_WRITE_THROUGH);
+
+  return virtualAddress + offset;
+}
+
 void printVirtualAddressInfo(VirtualAddress virtualAddress) {
   printf("\n=== Information for virtual address: %lx ===", virtualAddress);
   printf("\nCurrently active page directory: %lx", getPageDirectory());
@@ -99,6 +99,25 @@ PageDirectory *getPageDirectory();
  */
 VirtualAddress mapPage(VirtualAddress virtualAddress, PhysicalAddress physicalAddress);
 
+/*
+ * Map the given virtual address to the given physical address
+ * in the current page directory using the given page table attributes (e.g. PTE_USER, PTE_READ_WRITE)
+ * PTE_PRESENT is always added
+ */
+VirtualAddress mapPageWithAttributes(VirtualAddress virtualAddress, PhysicalAddress physicalAddress, uint32_t attributes);
+
+/*
+ * Remove the mapping of the given virtual address from the current page directory, if any
+ */
+void unmapPage(VirtualAddress virtualAddress);
+
+/*
+ * Map 'size' bytes of device registers starting at the given physical address
+ * into the kernel device memory window, with caching disabled
+ * Returns the virtual address corresponding to 'physicalAddress', 0 if the window is full
+ */
+VirtualAddress mapDeviceMemory(PhysicalAddress physicalAddress, uint32_t size);
+
 /*
  * Map the reserved quickmap page table to the given physical address
  */
@@ -0,0 +1,19 @@
+#pragma once
+#include <stdint.h>
+
+/*
+ * Events of a PollDescriptor
+ */
+#define POLL_IN      0x1  // Data can be read without waiting
+#define POLL_OUT     0x4  // Data can be written without waiting
+#define POLL_INVALID 0x20 // The file descriptor isn't open (only set in 'returnedEvents')
+
+/*
+ * File descriptor given to poll, with the events to wait for
+ * 'returnedEvents' is filled with the events that are ready
+ */
+typedef struct {
+  int32_t fd;
+  uint16_t events;
+  uint16_t returnedEvents;
+} PollDescriptor;
@@ -0,0 +1,69 @@
+#pragma once
+#include <stdint.h>
+
+/*
+ * Virtual address where the kernel maps the shared page (read-only) for user code
+ * Last page right below KERNEL_BASE
+ */
+#define SHARED_PAGE_USER_ADDRESS 0xBFFFF000
+
+/*
+ * Data the kernel publishes on every timer tick, readable without any syscall
+ *
+ * The kernel increments 'sequence' before and after updating the page,
+ * so it is odd while an update is in progress (see readSharedPage)
+ */
+typedef struct {
+  uint32_t sequence;
+  uint32_t tickFrequency;          // PIT ticks per second
+  uint32_t tickPeriodMicroseconds; // Microseconds between two ticks
+  uint32_t syscalls;               // Total number of syscalls invoked since boot
+  uint64_t ticks;                  // PIT ticks since the shared page was initialized
+  uint64_t tscAtLastTick;          // TSC value read on the last tick
+  uint64_t tscPerTick;             // TSC cycles per tick (calibrated against the PIT)
+} SharedPageData;
+
+/*
+ * Take a consistent snapshot of the shared page
+ * Retry if the kernel updated the page while we were copying it
+ */
+static inline void readSharedPage(SharedPageData *snapshot) {
+  volatile SharedPageData *page = (volatile SharedPageData *)SHARED_PAGE_USER_ADDRESS;
+  uint32_t sequence;
+
+  do {
+    sequence = page->sequence;
+    asm volatile("" : : : "memory");
+
+    snapshot->tickFrequency = page->tickFrequency;
+    snapshot->tickPeriodMicroseconds = page->tickPeriodMicroseconds;
+    snapshot->syscalls = page->syscalls;
+    snapshot->ticks = page->ticks;
+    snapshot->tscAtLastTick = page->tscAtLastTick;
+    snapshot->tscPerTick = page->tscPerTick;
+
+    asm volatile("" : : : "memory");
+  } while ((sequence & 1) || sequence != page->sequence);
+
+  snapshot->sequence = sequence;
+}
+
+/*
+ * Get the number of PIT ticks since boot
+ */
+static inline uint64_t uptimeTicks(void) {
+  SharedPageData snapshot;
+  readSharedPage(&snapshot);
+
+  return snapshot.ticks;
+}
+
+/*
+ * Get the time since boot in microseconds (tick resolution)
+ */
+static inline uint64_t uptimeMicroseconds(void) {
+  SharedPageData snapshot;
+  readSharedPage(&snapshot);
+
+  return snapshot.ticks * snapshot.tickPeriodMicroseconds;
+}
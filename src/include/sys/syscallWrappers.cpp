@@ -5,9 +5,82 @@
 int32_t syscallTestWrapper() {
   int32_t result = -1;
 
-  asm volatile("int $0x80" : "=a"(result) : "a"(SYSCALL_TEST));
+  asm volatile("int $0x80" : "=a"(result) : "a"(SYSCALL_TEST) : "edx");
 
   return result;
 }
 
+int32_t invokeSyscall(uint32_t number, uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4, uint32_t *extra) {
+  int32_t result = -1;
+  uint32_t second = 0;
+
+  asm volatile("int $0x80" : "=a"(result), "=d"(second) : "a"(number), "b"(arg1), "c"(arg2), "d"(arg3), "S"(arg4) : "memory");
+
+  if (extra) *extra = second;
+
+  return result;
+}
+
+int32_t syscallStatsWrapper(uint32_t syscall, SyscallStatistics *stats) {
+  return invokeSyscall(SYSCALL_STATS, syscall, (uint32_t)stats);
+}
+
+int32_t syncWrapper() {
+  return invokeSyscall(SYSCALL_SYNC);
+}
 
+void* mmapWrapper(const char *path, uint32_t offset, uint32_t size) {
+  return (void *)invokeSyscall(SYSCALL_MMAP, (uint32_t)path, offset, size);
+}
+
+int32_t munmapWrapper(void *address) {
+  return invokeSyscall(SYSCALL_MUNMAP, (uint32_t)address);
+}
+
+int32_t sendFileWrapper(int32_t out, int32_t in, uint32_t size) {
+  return invokeSyscall(SYSCALL_SENDFILE, out, in, size);
+}
+
+int32_t readvWrapper(int32_t fd, const IOVector *vectors, uint32_t count) {
+  return invokeSyscall(SYSCALL_READV, fd, (uint32_t)vectors, count);
+}
+
+int32_t writevWrapper(int32_t fd, const IOVector *vectors, uint32_t count) {
+  return invokeSyscall(SYSCALL_WRITEV, fd, (uint32_t)vectors, count);
+}
+
+int32_t preadWrapper(int32_t fd, void *buffer, uint32_t size, uint32_t offset) {
+  return invokeSyscall(SYSCALL_PREAD, fd, (uint32_t)buffer, size, offset);
+}
+
+int32_t pwriteWrapper(int32_t fd, const void *buffer, uint32_t size, uint32_t offset) {
+  return invokeSyscall(SYSCALL_PWRITE, fd, (uint32_t)buffer, size, offset);
+}
+
+int32_t openWrapper(const char *path) {
+  return invokeSyscall(SYSCALL_OPEN, (uint32_t)path);
+}
+
+int32_t closeWrapper(int32_t fd) {
+  return invokeSyscall(SYSCALL_CLOSE, fd);
+}
+
+int32_t readWrapper(int32_t fd, void *buffer, uint32_t size) {
+  return invokeSyscall(SYSCALL_READ, fd, (uint32_t)buffer, size);
+}
+
+int32_t writeWrapper(int32_t fd, const void *buffer, uint32_t size) {
+  return invokeSyscall(SYSCALL_WRITE, fd, (uint32_t)buffer, size);
+}
+
+int32_t dupWrapper(int32_t fd) {
+  return invokeSyscall(SYSCALL_DUP, fd);
+}
+
+int32_t pollWrapper(PollDescriptor *descriptors, uint32_t count, int32_t timeout) {
+  return invokeSyscall(SYSCALL_POLL, (uint32_t)descriptors, count, timeout);
+}
+
+int32_t fcntlWrapper(int32_t fd, uint32_t command, uint32_t flags) {
+  return invokeSyscall(SYSCALL_FCNTL, fd, command, flags);
+}
@@ -1,7 +1,87 @@
 #pragma once
 #include <stdint.h>
+#include <syscallStatistics.h>
+#include <pollDescriptor.h>
+#include <ioVector.h>
+#include <fileControl.h>
 
 /*
  * Test syscall
  */
 int32_t syscallTestWrapper();
+
+/*
+ * Invoke the given syscall with up to 4 arguments (passed in ebx, ecx, edx and esi)
+ * Returns the main result of the syscall (eax),
+ * the optional second result (edx) is stored in 'extra' if given
+ */
+int32_t invokeSyscall(uint32_t number, uint32_t arg1 = 0, uint32_t arg2 = 0, uint32_t arg3 = 0, uint32_t arg4 = 0, uint32_t *extra = 0);
+
+/*
+ * Get the statistics (calls and latency) recorded by the kernel for the given syscall
+ */
+int32_t syscallStatsWrapper(uint32_t syscall, SyscallStatistics *stats);
+
+/*
+ * Write the modified file system blocks back to the disk, returns once they are written
+ */
+int32_t syncWrapper();
+
+/*
+ * Map 'size' bytes (0 for the whole file) of the file at 'path' starting at 'offset' (page aligned), read only
+ * Returns the address of the mapping, NULL on failure
+ */
+void* mmapWrapper(const char *path, uint32_t offset = 0, uint32_t size = 0);
+
+int32_t munmapWrapper(void *address);
+
+/*
+ * Copy up to 'size' bytes from the offset of 'in' to the offset of 'out' inside the kernel, without a user buffer
+ * Returns the number of bytes copied, -1 if one of the file descriptors isn't open
+ */
+int32_t sendFileWrapper(int32_t out, int32_t in, uint32_t size);
+
+/*
+ * Read or write the 'count' buffers in order, as a single transfer at the offset of the file descriptor
+ * Returns the total number of bytes transferred, -1 if the file descriptor isn't open
+ */
+int32_t readvWrapper(int32_t fd, const IOVector *vectors, uint32_t count);
+int32_t writevWrapper(int32_t fd, const IOVector *vectors, uint32_t count);
+
+/*
+ * Read or write at 'offset', the offset of the file descriptor isn't used nor moved
+ * Returns the number of bytes transferred, -1 if the file descriptor isn't open
+ */
+int32_t preadWrapper(int32_t fd, void *buffer, uint32_t size, uint32_t offset);
+int32_t pwriteWrapper(int32_t fd, const void *buffer, uint32_t size, uint32_t offset);
+
+/*
+ * Open the file at 'path', returns its file descriptor, -1 on failure
+ */
+int32_t openWrapper(const char *path);
+
+int32_t closeWrapper(int32_t fd);
+
+/*
+ * Read or write at the offset of the file descriptor, which is moved past the transferred bytes
+ * Returns the number of bytes transferred, -1 if the file descriptor isn't open
+ */
+int32_t readWrapper(int32_t fd, void *buffer, uint32_t size);
+int32_t writeWrapper(int32_t fd, const void *buffer, uint32_t size);
+
+/*
+ * Open the file of 'fd' at another file descriptor (the lowest free one), sharing its offset
+ */
+int32_t dupWrapper(int32_t fd);
+
+/*
+ * Sleep until one of the file descriptors is ready for its events, or for 'timeout' milliseconds (-1: forever)
+ * Returns the number of descriptors with returned events, 0 on timeout
+ */
+int32_t pollWrapper(PollDescriptor *descriptors, uint32_t count, int32_t timeout);
+
+/*
+ * Get or set the flags of the file descriptor (see fileControl.h), e.g. to make its reads non-blocking
+ * Returns the flags for FCNTL_GET_FLAGS, -1 if the file descriptor isn't open or the command is unknown
+ */
+int32_t fcntlWrapper(int32_t fd, uint32_t command, uint32_t flags = 0);
@@ -4,4 +4,20 @@ typedef enum {
   SYSCALL_TEST   = 0,
   SYSCALL_MALLOC = 1,
   SYSCALL_FREE   = 2,
+  SYSCALL_STATS  = 3,
+  SYSCALL_SYNC   = 4,
+  SYSCALL_MMAP   = 5,
+  SYSCALL_MUNMAP = 6,
+  SYSCALL_SENDFILE = 7,
+  SYSCALL_READV  = 8,
+  SYSCALL_WRITEV = 9,
+  SYSCALL_PREAD  = 10,
+  SYSCALL_PWRITE = 11,
+  SYSCALL_OPEN   = 12,
+  SYSCALL_CLOSE  = 13,
+  SYSCALL_READ   = 14,
+  SYSCALL_WRITE  = 15,
+  SYSCALL_DUP    = 16,
+  SYSCALL_POLL   = 17,
+  SYSCALL_FCNTL  = 18,
 } syscallNumbers;
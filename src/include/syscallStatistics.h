@@ -0,0 +1,23 @@
+#pragma once
+#include <stdint.h>
+
+/*
+ * Number of buckets of the syscall latency histogram
+ * Bucket 0 counts the syscalls that took less than 2^SYSCALL_LATENCY_FIRST_BUCKET_SHIFT cycles,
+ * bucket i counts the ones that took [2^(i + SHIFT - 1), 2^(i + SHIFT)) cycles,
+ * the last bucket counts everything above
+ */
+#define SYSCALL_LATENCY_BUCKETS 16
+#define SYSCALL_LATENCY_FIRST_BUCKET_SHIFT 7 // 128 cycles
+
+/*
+ * Statistics recorded by the kernel for each syscall
+ * Shared between the kernel and the SYSCALL_STATS callers
+ */
+typedef struct {
+  uint32_t calls;        // How many times the syscall was invoked
+  uint64_t totalCycles;  // Sum of the latency (TSC cycles) of all the calls
+  uint64_t minCycles;    // Fastest call
+  uint64_t maxCycles;    // Slowest call
+  uint32_t histogram[SYSCALL_LATENCY_BUCKETS]; // Latency histogram (log2 buckets, see above)
+} SyscallStatistics;
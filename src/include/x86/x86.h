@@ -1,4 +1,40 @@
 #pragma once
 #include <stdint.h>
 
-void x86_div64_32(uint64_t dividend, uint32_t divisor, uint64_t *quotientOut, uint32_t *remainderOut);
+extern "C" void x86_div64_32(uint64_t dividend, uint32_t divisor, uint64_t *quotientOut, uint32_t *remainderOut);
+
+/*
+ * Read the Time Stamp Counter (number of CPU cycles since reset)
+ * 'rdtsc' puts the 64 bits counter in edx:eax, the "A" constraint tells the compiler so
+ */
+static inline uint64_t readTSC(void) {
+  uint64_t tsc;
+
+  asm volatile("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+
+/*
+ * Read the CR2 control register, which holds the address that caused the last page fault
+ */
+static inline uint32_t readCR2(void) {
+  uint32_t cr2;
+
+  asm volatile("mov %%cr2, %0" : "=r" (cr2));
+  return cr2;
+}
+
+/*
+ * Disable interrupts and return the previous EFLAGS, to be given back to restoreInterrupts
+ * Unlike a plain cli/sti pair, this never enables interrupts when called from an IRQ handler
+ */
+static inline uint32_t disableInterrupts(void) {
+  uint32_t flags;
+
+  asm volatile("pushf\n pop %0\n cli" : "=r" (flags) : : "memory");
+  return flags;
+}
+
+static inline void restoreInterrupts(uint32_t flags) {
+  asm volatile("push %0\n popf" : : "r" (flags) : "memory", "cc");
+}
@@ -0,0 +1,158 @@
+#pragma once
+#include <stdint.h>
+
+/*
+ * AHCI (Advanced Host Controller Interface) structures, as described by the AHCI 1.3 specification
+ * The HBA (Host Bus Adapter) registers are memory mapped at BAR5 (ABAR) of the SATA controller
+ */
+
+#define AHCI_MAX_PORTS 32
+#define AHCI_MAX_COMMAND_SLOTS 32
+
+/* Generic host control: capabilities (CAP) */
+#define AHCI_CAP_NCS_SHIFT 8 // Number of command slots - 1 (bits 8-12)
+#define AHCI_CAP_NCS_MASK  0x1F
+#define AHCI_CAP_SNCQ      (1 << 30) // Supports native command queuing
+
+/* Generic host control: global host control (GHC) */
+#define AHCI_GHC_IE (1 << 1) // Interrupt enable
+#define AHCI_GHC_AE (1 << 31) // AHCI enable
+
+/* Port command and status (PxCMD) */
+#define AHCI_PORT_CMD_ST  (1 << 0) // Start processing the command list
+#define AHCI_PORT_CMD_FRE (1 << 4) // FIS receive enable
+#define AHCI_PORT_CMD_FR  (1 << 14) // FIS receive running
+#define AHCI_PORT_CMD_CR  (1 << 15) // Command list running
+
+/* Port interrupt status and enable (PxIS, PxIE) */
+#define AHCI_PORT_INT_DHRS (1 << 0) // Device to host register FIS received
+#define AHCI_PORT_INT_PSS  (1 << 1) // PIO setup FIS received
+#define AHCI_PORT_INT_SDBS (1 << 3) // Set device bits FIS received (NCQ completions)
+#define AHCI_PORT_INT_TFES (1 << 30) // Task file error
+
+/* Port task file data (PxTFD), mirrors the ATA status register */
+#define AHCI_PORT_TFD_ERR 0x01
+#define AHCI_PORT_TFD_DRQ 0x08
+#define AHCI_PORT_TFD_BSY 0x80
+
+/* Port SATA status (PxSSTS) */
+#define AHCI_PORT_SSTS_DET_PRESENT 0x3 // Device detected and communication established (bits 0-3)
+#define AHCI_PORT_SSTS_IPM_ACTIVE  0x1 // Interface in active state (bits 8-11)
+
+/* Port signature (PxSIG) */
+#define AHCI_SIGNATURE_ATA 0x00000101
+
+/* FIS (Frame Information Structure) types */
+#define FIS_TYPE_REG_H2D 0x27 // Register FIS, host to device
+
+/* ATA commands used through AHCI */
+#define AHCI_READ_DMA_EXT_CMD        0x25
+#define AHCI_READ_FPDMA_QUEUED_CMD   0x60 // NCQ read
+#define AHCI_WRITE_DMA_EXT_CMD       0x35
+#define AHCI_WRITE_FPDMA_QUEUED_CMD  0x61 // NCQ write
+#define AHCI_IDENTIFY_CMD            0xEC
+#define AHCI_READ_LOG_EXT_CMD        0x2F
+
+/* NCQ command error log (READ LOG EXT log address 10h), byte 0 */
+#define AHCI_LOG_NCQ_ERROR    0x10
+#define AHCI_NCQ_LOG_TAG_MASK 0x1F // Tag of the command that failed
+#define AHCI_NCQ_LOG_NQ       0x80 // The error wasn't caused by a queued command
+
+typedef struct {
+  uint32_t commandListBase; // 1 KiB aligned
+  uint32_t commandListBaseUpper;
+  uint32_t fisBase; // 256 bytes aligned
+  uint32_t fisBaseUpper;
+  uint32_t interruptStatus;
+  uint32_t interruptEnable;
+  uint32_t command;
+  uint32_t reserved0;
+  uint32_t taskFileData;
+  uint32_t signature;
+  uint32_t sataStatus;
+  uint32_t sataControl;
+  uint32_t sataError;
+  uint32_t sataActive; // NCQ tags still outstanding
+  uint32_t commandIssue; // Command slots still outstanding
+  uint32_t sataNotification;
+  uint32_t fisSwitchingControl;
+  uint32_t reserved1[11];
+  uint32_t vendor[4];
+} __attribute__ ((packed)) HBAPort;
+
+typedef struct {
+  uint32_t capabilities;
+  uint32_t globalHostControl;
+  uint32_t interruptStatus; // One bit per port
+  uint32_t portsImplemented;
+  uint32_t version;
+  uint32_t cccControl;
+  uint32_t cccPorts;
+  uint32_t enclosureLocation;
+  uint32_t enclosureControl;
+  uint32_t capabilitiesExtended;
+  uint32_t biosHandoff;
+  uint8_t reserved[0x74];
+  uint8_t vendor[0x60];
+  HBAPort ports[AHCI_MAX_PORTS];
+} __attribute__ ((packed)) HBAMemory;
+
+/*
+ * Entry of the command list, one per command slot
+ */
+typedef struct {
+  uint8_t fisLength : 5; // Command FIS length in dwords
+  uint8_t atapi : 1;
+  uint8_t write : 1; // Direction: 1 host to device
+  uint8_t prefetchable : 1;
+  uint8_t reset : 1;
+  uint8_t bist : 1;
+  uint8_t clearBusy : 1;
+  uint8_t reserved0 : 1;
+  uint8_t portMultiplier : 4;
+  uint16_t prdtLength; // Number of PRDT entries
+  volatile uint32_t prdByteCount; // Bytes transferred
+  uint32_t commandTableBase; // 128 bytes aligned
+  uint32_t commandTableBaseUpper;
+  uint32_t reserved1[4];
+} __attribute__ ((packed)) HBACommandHeader;
+
+/*
+ * Scatter-gather entry of a command table
+ */
+typedef struct {
+  uint32_t dataBase; // 2 bytes aligned
+  uint32_t dataBaseUpper;
+  uint32_t reserved0;
+  uint32_t byteCount : 22; // Bytes - 1, up to 4 MiB
+  uint32_t reserved1 : 9;
+  uint32_t interruptOnCompletion : 1;
+} __attribute__ ((packed)) HBAPRDTEntry;
+
+#define AHCI_PRDT_MAX_BYTES 0x400000
+
+typedef struct {
+  uint8_t type;
+  uint8_t portMultiplier : 4;
+  uint8_t reserved0 : 3;
+  uint8_t isCommand : 1; // 1 command, 0 control
+  uint8_t command;
+  uint8_t featureLow;
+
+  uint8_t lba0;
+  uint8_t lba1;
+  uint8_t lba2;
+  uint8_t device;
+
+  uint8_t lba3;
+  uint8_t lba4;
+  uint8_t lba5;
+  uint8_t featureHigh;
+
+  uint8_t countLow;
+  uint8_t countHigh;
+  uint8_t isochronousCommandCompletion;
+  uint8_t control;
+
+  uint8_t reserved1[4];
+} __attribute__ ((packed)) FISRegisterHostToDevice;
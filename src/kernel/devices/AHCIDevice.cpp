@@ -0,0 +1,388 @@
+#include <string.h>
+#include <x86/x86.h>
+#include <memLayout.h>
+#include <virtualMem.h>
+#include <kernel/devices/AHCIDevice.h>
+#include <kernel/interrupts/pic.h>
+#include <kernel/pci/pci.h>
+#include <kernel/utils/kprintf.h>
+
+typedef struct {
+  uint8_t commandFIS[64];
+  uint8_t atapiCommand[16];
+  uint8_t reserved[48];
+  HBAPRDTEntry prdt[AHCI_PRDT_ENTRIES];
+} __attribute__ ((packed, aligned(128))) HBACommandTable;
+
+/*
+ * Memory shared with the controller, only one port is used
+ */
+static HBACommandHeader commandList[AHCI_MAX_COMMAND_SLOTS] __attribute__ ((aligned(1024)));
+static uint8_t receivedFIS[256] __attribute__ ((aligned(256)));
+static HBACommandTable commandTables[AHCI_MAX_COMMAND_SLOTS];
+static uint8_t errorLog[SECTOR_SIZE] __attribute__ ((aligned(2)));
+
+// We can only have one instance of AHCIDevice
+static AHCIDevice *s_the;
+
+AHCIDevice* AHCIDevice::create() {
+  PCI::Address address;
+
+  if (!PCI::findDevice(PCI_CLASS_MASS_STORAGE, PCI_SUBCLASS_SATA, address)) return NULL;
+
+  // Only legacy (PIC) interrupts are supported, 0xFF means no interrupt line is routed
+  uint8_t irq = PCI::interruptLine(address);
+  if (irq >= 16) return NULL;
+
+  uint32_t bar = PCI::getBAR(address, 5);
+  if (bar & PCI_BAR_IO) return NULL;
+
+  PCI::enableBusMastering(address);
+
+  volatile HBAMemory *hba = (volatile HBAMemory *)mapDeviceMemory(bar & PCI_BAR_MEM_MASK, sizeof(HBAMemory));
+  if (!hba) return NULL;
+
+  hba->globalHostControl |= AHCI_GHC_AE;
+
+  for (uint8_t port = 0; port < AHCI_MAX_PORTS; port++) {
+    if (!(hba->portsImplemented & (1u << port))) continue;
+
+    uint32_t status = hba->ports[port].sataStatus;
+    if ((status & 0xF) != AHCI_PORT_SSTS_DET_PRESENT || ((status >> 8) & 0xF) != AHCI_PORT_SSTS_IPM_ACTIVE) continue;
+    if (hba->ports[port].signature != AHCI_SIGNATURE_ATA) continue;
+
+    return new AHCIDevice(hba, port, irq);
+  }
+
+  return NULL;
+}
+
+AHCIDevice& AHCIDevice::the() {
+  return *s_the;
+}
+
+AHCIDevice::AHCIDevice(volatile HBAMemory *hba, uint8_t port, uint8_t irq)
+  : IRQHandler(irq), BlockDevice(), _hba(hba), _port(&hba->ports[port]), _portNumber(port) {
+  s_the = this;
+
+  stopCommandEngine();
+
+  memset(commandList, 0x0, sizeof(commandList));
+  memset(receivedFIS, 0x0, sizeof(receivedFIS));
+
+  for (uint8_t slot = 0; slot < AHCI_MAX_COMMAND_SLOTS; slot++)
+    commandList[slot].commandTableBase = physicalAddressOf(&commandTables[slot]);
+
+  _port->commandListBase = physicalAddressOf(commandList);
+  _port->commandListBaseUpper = 0;
+  _port->fisBase = physicalAddressOf(receivedFIS);
+  _port->fisBaseUpper = 0;
+
+  // Clear pending errors and interrupts (write 1 to clear)
+  _port->sataError = 0xFFFFFFFF;
+  _port->interruptStatus = 0xFFFFFFFF;
+  _hba->interruptStatus = 1u << _portNumber;
+
+  startCommandEngine();
+
+  _port->interruptEnable = AHCI_PORT_INT_DHRS | AHCI_PORT_INT_PSS | AHCI_PORT_INT_SDBS | AHCI_PORT_INT_TFES;
+  _hba->globalHostControl |= AHCI_GHC_IE;
+
+  if (irq >= 8) PIC::enable(PIC_IRQ_CASCADE);
+  enableIRQ();
+
+  identify();
+
+  kprintf("AHCI: SATA disk on port %d, irq %d, NCQ %s, queue depth %d\n", port, irq, _ncq ? "on" : "off", _queueDepth);
+}
+
+void AHCIDevice::stopCommandEngine() {
+  _port->command &= ~AHCI_PORT_CMD_ST;
+  _port->command &= ~AHCI_PORT_CMD_FRE;
+
+  while (_port->command & (AHCI_PORT_CMD_FR | AHCI_PORT_CMD_CR));
+}
+
+void AHCIDevice::startCommandEngine() {
+  while (_port->command & AHCI_PORT_CMD_CR);
+
+  _port->command |= AHCI_PORT_CMD_FRE;
+  _port->command |= AHCI_PORT_CMD_ST;
+}
+
+void AHCIDevice::identify() {
+  uint16_t identify[SECTOR_SIZE / 2];
+  FISRegisterHostToDevice fis;
+  BlockRequest request;
+
+  memset(&fis, 0x0, sizeof(fis));
+  fis.type = FIS_TYPE_REG_H2D;
+  fis.isCommand = 1;
+  fis.command = AHCI_IDENTIFY_CMD;
+
+  memset(&request, 0x0, sizeof(request));
+  request.buffer = (uint8_t *)identify;
+  request.count = 1;
+
+  // Nothing else has been queued yet, so slot 0 is free
+  uint32_t flags = disableInterrupts();
+  _busySlots |= 1;
+  bool issued = issueCommand(0, fis, request);
+
+  while (issued && (_pendingSlots & 1)) asm volatile("sti\n hlt\n cli");
+
+  _busySlots &= ~1u;
+  restoreInterrupts(flags);
+
+  if (!issued || (_failedSlots & 1)) {
+    _failedSlots &= ~1u;
+    return;
+  }
+
+  uint8_t controllerSlots = ((_hba->capabilities >> AHCI_CAP_NCS_SHIFT) & AHCI_CAP_NCS_MASK) + 1;
+  uint8_t diskDepth = (identify[75] & 0x1F) + 1;
+
+  // Word 76 bit 8: NCQ supported, word 75 (bits 0-4): maximum queue depth - 1
+  // The last slot of the controller is kept to read the error log
+  _ncq = (_hba->capabilities & AHCI_CAP_SNCQ) && (identify[76] & (1 << 8)) && controllerSlots > 1;
+  if (!_ncq) return;
+
+  _recoverySlot = controllerSlots - 1;
+  _queueDepth = _recoverySlot < diskDepth ? _recoverySlot : diskDepth;
+}
+
+/*
+ * A command completes when its bit is cleared from both the command issue and the SATA active registers
+ * On a task file error the port is restarted, the commands still outstanding have been aborted:
+ * - without NCQ (or when retrying one at a time) the only outstanding command is the one that failed
+ * - with NCQ they wait in _retrySlots while the error log is read, then the failing one is completed
+ *   and the others are issued again
+ */
+void AHCIDevice::handleIRQ() {
+  uint32_t status = _port->interruptStatus;
+
+  _port->interruptStatus = status;
+  _hba->interruptStatus = 1u << _portNumber;
+
+  uint32_t aborted = 0;
+
+  if (status & AHCI_PORT_INT_TFES) {
+    aborted = _pendingSlots & (_port->sataActive | _port->commandIssue);
+    _pendingSlots = 0;
+
+    stopCommandEngine();
+    _port->sataError = 0xFFFFFFFF;
+    startCommandEngine();
+  } else {
+    _pendingSlots &= _port->sataActive | _port->commandIssue;
+  }
+
+  uint32_t recoverySlot = 1u << _recoverySlot;
+
+  if (_readingLog && !(_pendingSlots & recoverySlot)) {
+    uint8_t tag = errorLog[0] & AHCI_NCQ_LOG_TAG_MASK;
+
+    _readingLog = false;
+    _busySlots &= ~recoverySlot;
+
+    if (!(aborted & recoverySlot) && !(errorLog[0] & AHCI_NCQ_LOG_NQ) && (_retrySlots & (1u << tag))) {
+      _failedSlots |= 1u << tag;
+      _retrySlots &= ~(1u << tag);
+    } else {
+      // The failing command is unknown, each of them is retried alone to find it
+      _serialRetry = true;
+    }
+  } else if (aborted) {
+    if (_ncq && !_serialRetry) {
+      _retrySlots |= aborted;
+      readErrorLog();
+    } else {
+      _failedSlots |= aborted;
+    }
+  }
+
+  if (!_readingLog) retry();
+
+  // Completed: holding a request, and neither outstanding nor waiting to be retried
+  uint32_t completed = _busySlots & ~_pendingSlots & ~_retrySlots;
+
+  for (uint8_t slot = 0; slot < AHCI_MAX_COMMAND_SLOTS; slot++) {
+    if (!(completed & (1u << slot)) || !_slotRequests[slot]) continue;
+
+    BlockRequest *request = _slotRequests[slot];
+    bool failed = _failedSlots & (1u << slot);
+
+    _slotRequests[slot] = NULL;
+    _failedSlots &= ~(1u << slot);
+    _busySlots &= ~(1u << slot);
+
+    completeRequest(*request, !failed);
+  }
+}
+
+/*
+ * Reading the log also takes the disk out of its NCQ error state, so it accepts queued commands again
+ */
+void AHCIDevice::readErrorLog() {
+  FISRegisterHostToDevice fis;
+  BlockRequest request;
+
+  memset(&fis, 0x0, sizeof(fis));
+  fis.type = FIS_TYPE_REG_H2D;
+  fis.isCommand = 1;
+  fis.command = AHCI_READ_LOG_EXT_CMD;
+  fis.lba0 = AHCI_LOG_NCQ_ERROR;
+  fis.countLow = 1;
+
+  memset(&request, 0x0, sizeof(request));
+  request.type = BLOCK_REQUEST_READ;
+  request.buffer = errorLog;
+  request.count = 1;
+
+  memset(errorLog, 0x0, sizeof(errorLog));
+  _busySlots |= 1u << _recoverySlot;
+  _readingLog = issueCommand(_recoverySlot, fis, request);
+
+  if (!_readingLog) {
+    _busySlots &= ~(1u << _recoverySlot);
+    _serialRetry = true;
+  }
+}
+
+/*
+ * The requests were issued from the same slots before, so their buffers are valid and issueCommand only fails
+ * if it did the first time
+ */
+void AHCIDevice::retry() {
+  if (_serialRetry && _pendingSlots) return;
+
+  for (uint8_t slot = 0; slot < AHCI_MAX_COMMAND_SLOTS && _retrySlots; slot++) {
+    if (!(_retrySlots & (1u << slot))) continue;
+
+    FISRegisterHostToDevice fis;
+    buildFIS(fis, slot, *_slotRequests[slot], !_serialRetry);
+
+    _retrySlots &= ~(1u << slot);
+    if (!issueCommand(slot, fis, *_slotRequests[slot])) _failedSlots |= 1u << slot;
+
+    if (_serialRetry) return;
+  }
+
+  // Every aborted command has been issued again and the last one retried alone is done
+  if (!_pendingSlots) _serialRetry = false;
+}
+
+int32_t AHCIDevice::allocateSlot() {
+  for (uint8_t slot = 0; slot < _queueDepth; slot++) {
+    if (_busySlots & (1u << slot)) continue;
+
+    _busySlots |= 1u << slot;
+    return slot;
+  }
+
+  return -1;
+}
+
+/*
+ * The buffers are described page by page, merging the pages that are physically contiguous
+ */
+bool AHCIDevice::issueCommand(uint8_t slot, const FISRegisterHostToDevice& fis, BlockRequest& request) {
+  HBACommandTable& table = commandTables[slot];
+  uint16_t entries = 0;
+
+  memset(&table, 0x0, sizeof(HBACommandTable));
+  memcpy(table.commandFIS, (void *)&fis, sizeof(fis));
+
+  for (BlockRequest *segment = &request; segment; segment = segment->merged) {
+    uint8_t *buffer = segment->buffer;
+    uint32_t bytes = segment->count * SECTOR_SIZE;
+
+    // Linear mapped and 2 byte aligned, the request fails otherwise
+    if (!isDMABuffer(buffer, bytes)) return false;
+
+    while (bytes) {
+      uint32_t size = PAGE_SIZE - ((uint32_t)buffer & (PAGE_SIZE - 1));
+      if (size > bytes) size = bytes;
+
+      uint32_t physicalAddress = physicalAddressOf(buffer);
+      HBAPRDTEntry *last = entries ? &table.prdt[entries - 1] : NULL;
+
+      if (last && last->dataBase + last->byteCount + 1 == physicalAddress && last->byteCount + 1 + size <= AHCI_PRDT_MAX_BYTES) {
+        last->byteCount += size;
+      } else {
+        if (entries == AHCI_PRDT_ENTRIES) return false;
+
+        table.prdt[entries].dataBase = physicalAddress;
+        table.prdt[entries].byteCount = size - 1;
+        entries++;
+      }
+
+      buffer += size;
+      bytes -= size;
+    }
+  }
+
+  HBACommandHeader& header = commandList[slot];
+  header.fisLength = sizeof(FISRegisterHostToDevice) / sizeof(uint32_t);
+  header.write = request.type == BLOCK_REQUEST_WRITE;
+  header.prdtLength = entries;
+  header.prdByteCount = 0;
+
+  _pendingSlots |= 1u << slot;
+  if (fis.command == AHCI_READ_FPDMA_QUEUED_CMD || fis.command == AHCI_WRITE_FPDMA_QUEUED_CMD) _port->sataActive = 1u << slot;
+  _port->commandIssue = 1u << slot;
+
+  return true;
+}
+
+/*
+ * NCQ commands carry the sector count in the features registers and the tag (the slot) in the count register
+ */
+void AHCIDevice::buildFIS(FISRegisterHostToDevice& fis, uint8_t slot, BlockRequest& request, bool queued) {
+  uint32_t sector = request.sector;
+  uint32_t count = request.totalCount;
+  bool write = request.type == BLOCK_REQUEST_WRITE;
+
+  memset(&fis, 0x0, sizeof(fis));
+  fis.type = FIS_TYPE_REG_H2D;
+  fis.isCommand = 1;
+  fis.lba0 = sector;
+  fis.lba1 = sector >> 8;
+  fis.lba2 = sector >> 16;
+  fis.lba3 = sector >> 24;
+  fis.device = 1 << 6; // LBA mode
+
+  if (queued) {
+    fis.command = write ? AHCI_WRITE_FPDMA_QUEUED_CMD : AHCI_READ_FPDMA_QUEUED_CMD;
+    fis.featureLow = count;
+    fis.featureHigh = count >> 8;
+    fis.countLow = slot << 3;
+  } else {
+    fis.command = write ? AHCI_WRITE_DMA_EXT_CMD : AHCI_READ_DMA_EXT_CMD;
+    fis.countLow = count;
+    fis.countHigh = count >> 8;
+  }
+}
+
+/*
+ * Nothing new is issued during an error recovery, the queued requests are started once it's over
+ */
+bool AHCIDevice::startRequest(BlockRequest& request) {
+  if (isRecovering()) return false;
+
+  int32_t slot = allocateSlot();
+  if (slot < 0) return false;
+
+  FISRegisterHostToDevice fis;
+  buildFIS(fis, slot, request, _ncq);
+
+  _slotRequests[slot] = &request;
+
+  if (!issueCommand(slot, fis, request)) {
+    _slotRequests[slot] = NULL;
+    _busySlots &= ~(1u << slot);
+    completeRequest(request, false);
+  }
+
+  return true;
+}
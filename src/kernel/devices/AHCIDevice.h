@@ -0,0 +1,101 @@
+#pragma once
+#include <kernel/devices/AHCI.h>
+#include <kernel/devices/BlockDevice.h>
+#include <kernel/interrupts/IRQHandler.h>
+#include <mmu.h>
+
+/*
+ * Scatter-gather entries per command, a page each unless the pages are physically contiguous
+ */
+#define AHCI_PRDT_ENTRIES 24
+
+/*
+ * Largest read issued by a single command, each of the merged buffers may span one more page than its size
+ */
+#define AHCI_MAX_SECTORS_PER_COMMAND ((AHCI_PRDT_ENTRIES - BLOCK_MAX_SEGMENTS) * PAGE_SIZE / SECTOR_SIZE)
+
+/*
+ * SATA disk attached to an AHCI controller
+ * When both the controller and the disk support NCQ (native command queuing), up to 31 reads are
+ * in flight at the same time and the disk completes them in the order that suits it best
+ *
+ * An error aborts every queued command: the NCQ error log tells which one failed, only that request fails
+ * and the others are issued again. If the log can't be read, they are retried one at a time without NCQ
+ */
+class AHCIDevice final : public IRQHandler, public BlockDevice {
+  public:
+    /*
+     * Look for an AHCI controller with a SATA disk attached, returns NULL if there is none
+     */
+    static AHCIDevice* create();
+
+    static AHCIDevice& the();
+
+    virtual uint32_t maxSectorsPerRequest() const override { return AHCI_MAX_SECTORS_PER_COMMAND; }
+    virtual uint8_t queueDepth() const override { return _queueDepth; }
+
+  private:
+    AHCIDevice(volatile HBAMemory *hba, uint8_t port, uint8_t irq);
+
+    virtual void handleIRQ() override;
+
+    /*
+     * Issue a command for the given request in the first free slot, with NCQ the slot is the tag of the command
+     */
+    virtual bool startRequest(BlockRequest& request) override;
+
+    void stopCommandEngine();
+    void startCommandEngine();
+
+    /*
+     * Read the NCQ error log in the recovery slot, without waiting for it
+     */
+    void readErrorLog();
+
+    /*
+     * Issue the aborted commands again, all at once or one at a time when the failing one is unknown
+     */
+    void retry();
+
+    bool isRecovering() const { return _readingLog || _retrySlots || _serialRetry; }
+
+    /*
+     * Identify the disk and decide whether to use NCQ and how many commands to keep in flight
+     */
+    void identify();
+
+    int32_t allocateSlot();
+
+    /*
+     * Command FIS reading or writing the sectors of the request, an NCQ command tagged with the slot if 'queued'
+     */
+    void buildFIS(FISRegisterHostToDevice& fis, uint8_t slot, BlockRequest& request, bool queued);
+
+    /*
+     * Fill the command table of the given (allocated) slot with the buffers of the request and the ones merged into it,
+     * then issue the command (called with interrupts disabled)
+     * Returns false if the buffers need more than AHCI_PRDT_ENTRIES scatter-gather entries or aren't 2 bytes aligned
+     */
+    bool issueCommand(uint8_t slot, const FISRegisterHostToDevice& fis, BlockRequest& request);
+
+    volatile HBAMemory *_hba;
+    volatile HBAPort *_port;
+    uint8_t _portNumber;
+
+    bool _ncq { false };
+    uint8_t _queueDepth { 1 };
+    uint8_t _recoverySlot { 0 }; // Not used by requests, reads the NCQ error log
+
+    // Slots holding a command, and the request each of them is transferring
+    uint32_t _busySlots { 0 };
+    BlockRequest *_slotRequests[AHCI_MAX_COMMAND_SLOTS] { };
+    // Slots issued to the controller and not completed yet, and completed slots whose command failed
+    volatile uint32_t _pendingSlots { 0 };
+    volatile uint32_t _failedSlots { 0 };
+
+    // Error recovery: the error log is being read, slots aborted by the error waiting to be issued again,
+    // and whether they are retried one at a time without NCQ
+    bool _readingLog { false };
+    uint32_t _retrySlots { 0 };
+    bool _serialRetry { false };
+};
@@ -0,0 +1,64 @@
+#include <kernel/devices/ATA.h>
+#include <kernel/fileSystem/fs.h>
+
+/*
+ * Upper limit for the READ MULTIPLE block size, bigger blocks do not make the transfer faster
+ */
+#define MAX_SECTORS_PER_DRQ_BLOCK 16
+
+namespace ATA {
+
+/*
+ * Sectors transferred per DRQ block when using READ MULTIPLE, 0 if READ MULTIPLE is not enabled
+ */
+static uint8_t sectorsPerDRQBlock = 0;
+
+void initializePolling(void) {
+  sectorsPerDRQBlock = enableMultipleMode(MAX_SECTORS_PER_DRQ_BLOCK);
+}
+
+/*
+ * Issue a single read command for 'count' (up to DISK_MAX_SECTORS_PER_COMMAND) sectors
+ * With READ MULTIPLE the disk gets ready once per 'sectorsPerDRQBlock' sectors instead of once per sector
+ */
+static bool issueReadCommand(uint8_t *destination, uint32_t sector, uint32_t count) {
+  // Since we don't use the disk interrupts here, we need to wait until the disk answers
+  waitReady();
+
+  setupTransfer(sector, count);
+  command(sectorsPerDRQBlock ? DISK_READ_MULTIPLE_CMD : DISK_READ_CMD);
+
+  uint32_t sectorsPerBlock = sectorsPerDRQBlock ? sectorsPerDRQBlock : 1;
+
+  // Read data, one DRQ block at a time
+  while (count) {
+    uint32_t sectors = count < sectorsPerBlock ? count : sectorsPerBlock;
+
+    if (!waitData()) return false;
+    IO::insl(DISK_PORT_BASE, destination, sectors * SECTOR_SIZE / 4); // Read 4-bytes 128 times per sector
+
+    destination += sectors * SECTOR_SIZE;
+    count -= sectors;
+  }
+
+  return true;
+}
+
+/*
+ * Issue one command for every DISK_MAX_SECTORS_PER_COMMAND sectors
+ */
+bool readSectors(uint8_t *destination, uint32_t sector, uint32_t count) {
+  while (count) {
+    uint32_t sectors = count < DISK_MAX_SECTORS_PER_COMMAND ? count : DISK_MAX_SECTORS_PER_COMMAND;
+
+    if (!issueReadCommand(destination, sector, sectors)) return false;
+
+    destination += sectors * SECTOR_SIZE;
+    sector += sectors;
+    count -= sectors;
+  }
+
+  return true;
+}
+
+}
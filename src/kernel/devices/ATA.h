@@ -0,0 +1,115 @@
+#pragma once
+#include <stdint.h>
+#include <io.h>
+
+/*
+ * Port I/O helpers for the primary ATA disk (drive 0), shared by the polling reads used by the prekernel
+ * and the interrupt driven ATADevice
+ */
+namespace ATA {
+
+/*
+ * Read the status register (this also acknowledges a pending disk interrupt)
+ */
+static inline uint8_t status(void) {
+  return IO::inb(DISK_PORT_BASE + 7);
+}
+
+/*
+ * Wait until the disk is ready to accept a command (not busy and ready)
+ */
+static inline void waitReady(void) {
+  while ((status() & (DISK_STATUS_BSY | DISK_STATUS_DRDY)) != DISK_STATUS_DRDY);
+}
+
+/*
+ * Wait until the disk is no longer busy and has data to be transferred (DRQ)
+ * Returns false if the disk reported an error instead
+ */
+static inline bool waitData(void) {
+  uint8_t value;
+
+  while ((value = status()) & DISK_STATUS_BSY);
+
+  return !(value & DISK_STATUS_ERR) && (value & DISK_STATUS_DRQ);
+}
+
+/*
+ * Whether the given status means the disk has data ready to be transferred
+ */
+static inline bool dataReady(uint8_t value) {
+  return !(value & DISK_STATUS_ERR) && (value & DISK_STATUS_DRQ);
+}
+
+/*
+ * Load the sector count and the LBA registers for the next command
+ */
+static inline void setupTransfer(uint32_t sector, uint32_t count) {
+  IO::outb(DISK_PORT_BASE + 2, count); // count of sectors, 0 means 256
+  IO::outb(DISK_PORT_BASE + 3, sector); // Take the 1st LSB
+  IO::outb(DISK_PORT_BASE + 4, sector >> 8); // Take the 2nd LSB
+  IO::outb(DISK_PORT_BASE + 5, sector >> 16); // Take the 3rd LSB
+  IO::outb(DISK_PORT_BASE + 6, (sector >> 24) | 0xE0); // Take the 4th LSB (the MSB now)
+                                                       // 0xE0 -> 0b1110_0000
+                                                       // bit 4: drive number (0 in our case)
+                                                       // bit 5: always set
+                                                       // bit 6: set for LBA
+                                                       // bit 7: always set
+}
+
+/*
+ * Send the given command to the disk
+ */
+static inline void command(uint8_t cmd) {
+  IO::outb(DISK_PORT_BASE + 7, cmd);
+}
+
+/*
+ * Enable or disable the disk interrupts (nIEN bit of the device control register)
+ */
+static inline void setInterruptsEnabled(bool enabled) {
+  IO::outb(DISK_CONTROL_PORT, enabled ? 0x0 : 0x2);
+}
+
+/*
+ * Identify the disk and enable READ/WRITE MULTIPLE using up to 'maxSectors' sectors per DRQ block
+ * Returns the number of sectors per DRQ block, 0 if the disk does not support it
+ */
+static inline uint8_t enableMultipleMode(uint8_t maxSectors) {
+  uint16_t identify[512 / 2];
+
+  waitReady();
+  IO::outb(DISK_PORT_BASE + 6, 0xE0); // Drive 0, LBA
+  command(DISK_IDENTIFY_CMD);
+
+  if (!waitData()) return 0;
+  IO::insl(DISK_PORT_BASE, identify, sizeof(identify) / 4);
+
+  // Word 47 (bits 0-7): maximum number of sectors per DRQ block supported by READ/WRITE MULTIPLE
+  uint8_t sectors = identify[47] & 0xFF;
+  if (!sectors) return 0;
+  if (sectors > maxSectors) sectors = maxSectors;
+
+  waitReady();
+  IO::outb(DISK_PORT_BASE + 2, sectors);
+  IO::outb(DISK_PORT_BASE + 6, 0xE0);
+  command(DISK_SET_MULTIPLE_CMD);
+  waitReady();
+
+  if (status() & DISK_STATUS_ERR) return 0;
+
+  return sectors;
+}
+
+/*
+ * Identify the disk and enable READ MULTIPLE for the polling reads, if the disk supports it
+ */
+void initializePolling(void);
+
+/*
+ * Read 'count' sectors starting from 'sector' and put them in 'destination', polling the status register
+ * Used by the prekernel, which runs with interrupts disabled
+ */
+bool readSectors(uint8_t *destination, uint32_t sector, uint32_t count);
+
+}
@@ -0,0 +1,251 @@
+#include <io.h>
+#include <memLayout.h>
+#include <kernel/devices/ATADevice.h>
+#include <kernel/devices/ATA.h>
+#include <kernel/interrupts/pic.h>
+#include <kernel/pci/pci.h>
+#include <kernel/utils/kprintf.h>
+
+#define IRQ_ATA_PRIMARY 14
+
+/*
+ * Upper limit for the READ MULTIPLE block size, bigger blocks do not make the transfer faster
+ */
+#define MAX_SECTORS_PER_DRQ_BLOCK 16
+
+/*
+ * Entry of the PRD (Physical Region Descriptor) table, describes a physically contiguous buffer for DMA
+ * A region can't cross a 64 KiB boundary
+ */
+typedef struct {
+  uint32_t address; // Physical address, must be 2 byte aligned
+  uint16_t size; // Size in bytes, 0 means 64 KiB
+  uint16_t flags;
+} __attribute__ ((packed)) PhysicalRegionDescriptor;
+
+#define PRD_END_OF_TABLE 0x8000
+#define PRD_MAX_REGION_SIZE 0x10000
+
+/*
+ * A command transfers up to 128 KiB from up to BLOCK_MAX_SEGMENTS buffers,
+ * each buffer adds a region and every 64 KiB boundary crossed adds another one
+ */
+#define PRD_TABLE_ENTRIES (BLOCK_MAX_SEGMENTS * 2)
+
+// The table itself can't cross a 64 KiB boundary either
+static PhysicalRegionDescriptor prdTable[PRD_TABLE_ENTRIES] __attribute__ ((aligned(sizeof(PhysicalRegionDescriptor) * PRD_TABLE_ENTRIES)));
+
+// We can only have one instance of ATADevice
+static ATADevice *s_the;
+
+ATADevice::ATADevice() : IRQHandler(IRQ_ATA_PRIMARY), BlockDevice() {
+  s_the = this;
+
+  // Identify the disk with its interrupts disabled, then let it interrupt us
+  ATA::setInterruptsEnabled(false);
+  _sectorsPerDRQBlock = ATA::enableMultipleMode(MAX_SECTORS_PER_DRQ_BLOCK);
+  ATA::status();
+  ATA::setInterruptsEnabled(true);
+
+  initializeBusMaster();
+
+  // IRQ 14 reaches the CPU through the slave PIC, which is connected to IRQ 2 of the master
+  PIC::enable(PIC_IRQ_CASCADE);
+  enableIRQ();
+}
+
+ATADevice& ATADevice::the() {
+  return *s_the;
+}
+
+void ATADevice::initializeBusMaster() {
+  PCI::Address address;
+
+  if (!PCI::findDevice(PCI_CLASS_MASS_STORAGE, PCI_SUBCLASS_IDE, address)) return;
+
+  // Bit 7 of the programming interface: the controller supports bus mastering
+  if (!(PCI::read8(address, PCI_PROG_IF) & 0x80)) return;
+
+  uint32_t bar = PCI::getBAR(address, 4);
+  if (!(bar & PCI_BAR_IO)) return;
+
+  PCI::enableBusMastering(address);
+  _busMasterBase = bar & PCI_BAR_IO_MASK;
+
+  kprintf("ATA: bus master DMA at %x\n", _busMasterBase);
+}
+
+/*
+ * Reading the status register acknowledges the interrupt on the disk side
+ * A DMA command raises a single IRQ once done
+ * A PIO read raises one IRQ per DRQ block ready to be read, a PIO write one per DRQ block written
+ */
+void ATADevice::handleIRQ() {
+  uint8_t status = ATA::status();
+
+  if (!_active) return;
+
+  if (_activeDMA) {
+    uint8_t busMasterStatus = IO::inb(_busMasterBase + BUS_MASTER_STATUS);
+
+    IO::outb(_busMasterBase + BUS_MASTER_COMMAND, 0);
+    IO::outb(_busMasterBase + BUS_MASTER_STATUS, BUS_MASTER_STATUS_ERROR | BUS_MASTER_STATUS_INTERRUPT);
+
+    finishRequest(!(status & DISK_STATUS_ERR) && !(busMasterStatus & BUS_MASTER_STATUS_ERROR));
+    return;
+  }
+
+  if (_active->type == BLOCK_REQUEST_WRITE) {
+    if (status & DISK_STATUS_ERR) finishRequest(false);
+    else if (!_pioRemaining) finishRequest(true);
+    else if (!ATA::dataReady(status)) finishRequest(false);
+    else transferDRQBlock();
+    return;
+  }
+
+  if (!ATA::dataReady(status)) {
+    finishRequest(false);
+    return;
+  }
+
+  transferDRQBlock();
+  if (!_pioRemaining) finishRequest(true);
+}
+
+/*
+ * Read or write the next DRQ block, which may span several of the merged requests
+ */
+void ATADevice::transferDRQBlock() {
+  uint32_t sectorsPerBlock = _sectorsPerDRQBlock ? _sectorsPerDRQBlock : 1;
+  uint32_t sectors = _pioRemaining < sectorsPerBlock ? _pioRemaining : sectorsPerBlock;
+  bool write = _active->type == BLOCK_REQUEST_WRITE;
+
+  for (uint32_t i = 0; i < sectors; i++) {
+    uint8_t *data = _pioRequest->buffer + _pioSector * SECTOR_SIZE;
+
+    if (write) IO::outsl(DISK_PORT_BASE, data, SECTOR_SIZE / 4);
+    else IO::insl(DISK_PORT_BASE, data, SECTOR_SIZE / 4);
+
+    if (++_pioSector == _pioRequest->count) {
+      _pioRequest = _pioRequest->merged;
+      _pioSector = 0;
+    }
+  }
+
+  _pioRemaining -= sectors;
+}
+
+void ATADevice::finishRequest(bool success) {
+  BlockRequest *request = _active;
+
+  _active = NULL;
+  completeRequest(*request, success);
+}
+
+bool ATADevice::startRequest(BlockRequest& request) {
+  if (_active) return false;
+
+  _active = &request;
+  _activeDMA = canUseDMA(request);
+
+  ATA::waitReady();
+
+  if (_activeDMA) startDMA(request);
+  else startPIO(request);
+
+  return true;
+}
+
+/*
+ * Regions needed to describe the segment, one per 64 KiB boundary it crosses
+ */
+static uint32_t prdRegionsOf(BlockRequest& segment) {
+  uint32_t address = physicalAddressOf(segment.buffer);
+  uint32_t end = address + segment.count * SECTOR_SIZE;
+
+  return (end - 1) / PRD_MAX_REGION_SIZE - address / PRD_MAX_REGION_SIZE + 1;
+}
+
+/*
+ * The PRD table needs 2 byte aligned buffers it can get the physical address of, and has room for PRD_TABLE_ENTRIES regions
+ * Other requests are transferred with PIO
+ */
+bool ATADevice::canUseDMA(BlockRequest& request) {
+  uint32_t regions = 0;
+
+  if (!_busMasterBase) return false;
+
+  for (BlockRequest *segment = &request; segment; segment = segment->merged) {
+    if (!isDMABuffer(segment->buffer, segment->count * SECTOR_SIZE)) return false;
+
+    regions += prdRegionsOf(*segment);
+  }
+
+  return regions <= PRD_TABLE_ENTRIES;
+}
+
+/*
+ * A PIO write doesn't raise an IRQ for the first DRQ block, the disk asks for it as soon as it takes the command
+ */
+void ATADevice::startPIO(BlockRequest& request) {
+  bool write = request.type == BLOCK_REQUEST_WRITE;
+
+  _pioRequest = &request;
+  _pioSector = 0;
+  _pioRemaining = request.totalCount;
+
+  ATA::setupTransfer(request.sector, request.totalCount);
+
+  if (write) ATA::command(_sectorsPerDRQBlock ? DISK_WRITE_MULTIPLE_CMD : DISK_WRITE_CMD);
+  else ATA::command(_sectorsPerDRQBlock ? DISK_READ_MULTIPLE_CMD : DISK_READ_CMD);
+
+  if (!write) return;
+
+  if (!ATA::waitData()) {
+    finishRequest(false);
+    return;
+  }
+
+  transferDRQBlock();
+}
+
+/*
+ * Every buffer is described by the PRD table, split at 64 KiB boundaries
+ * canUseDMA checked that the buffers are linear mapped, so they're physically contiguous and one region
+ * per 64 KiB is enough
+ */
+void ATADevice::startDMA(BlockRequest& request) {
+  bool write = request.type == BLOCK_REQUEST_WRITE;
+  // The direction is seen from the disk side: a disk read writes into memory
+  uint8_t direction = write ? 0 : BUS_MASTER_COMMAND_READ;
+  uint8_t entries = 0;
+
+  for (BlockRequest *segment = &request; segment; segment = segment->merged) {
+    uint32_t address = physicalAddressOf(segment->buffer);
+    uint32_t remaining = segment->count * SECTOR_SIZE;
+
+    // canUseDMA checked that the regions fit in the table
+    while (remaining && entries < PRD_TABLE_ENTRIES) {
+      uint32_t size = PRD_MAX_REGION_SIZE - (address & (PRD_MAX_REGION_SIZE - 1));
+      if (size > remaining) size = remaining;
+
+      prdTable[entries].address = address;
+      prdTable[entries].size = size & 0xFFFF;
+      prdTable[entries].flags = 0;
+
+      address += size;
+      remaining -= size;
+      entries++;
+    }
+  }
+  prdTable[entries - 1].flags = PRD_END_OF_TABLE;
+
+  IO::outl(_busMasterBase + BUS_MASTER_PRDT, physicalAddressOf(prdTable));
+  IO::outb(_busMasterBase + BUS_MASTER_COMMAND, direction);
+  // Clear the error and interrupt bits by writing 1 to them
+  IO::outb(_busMasterBase + BUS_MASTER_STATUS, BUS_MASTER_STATUS_ERROR | BUS_MASTER_STATUS_INTERRUPT);
+
+  ATA::setupTransfer(request.sector, request.totalCount);
+  ATA::command(write ? DISK_WRITE_DMA_CMD : DISK_READ_DMA_CMD);
+  IO::outb(_busMasterBase + BUS_MASTER_COMMAND, direction | BUS_MASTER_COMMAND_START);
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <io.h>
+#include <kernel/devices/BlockDevice.h>
+#include <kernel/interrupts/IRQHandler.h>
+
+/*
+ * Primary ATA disk (drive 0) driven by its interrupt (IRQ 14)
+ * Instead of busy polling the status register, commands are started and the IRQ handler completes them
+ * Uses the bus master DMA when the PCI IDE controller supports it, PIO otherwise
+ */
+class ATADevice final : public IRQHandler, public BlockDevice {
+  public:
+    ATADevice();
+
+    static ATADevice& the();
+
+    virtual uint32_t maxSectorsPerRequest() const override { return DISK_MAX_SECTORS_PER_COMMAND; }
+
+  private:
+    virtual void handleIRQ() override;
+
+    virtual bool startRequest(BlockRequest& request) override;
+    void finishRequest(bool success);
+
+    bool canUseDMA(BlockRequest& request);
+    void startPIO(BlockRequest& request);
+    void transferDRQBlock();
+
+    /*
+     * Transfer using the bus master DMA, the disk reads or writes the memory without the CPU copying the data
+     */
+    void startDMA(BlockRequest& request);
+
+    /*
+     * Look for the PCI IDE controller and enable its bus master, so DMA can be used
+     */
+    void initializeBusMaster();
+
+    // Request being transferred, only one command at a time
+    BlockRequest *_active { NULL };
+    bool _activeDMA { false };
+
+    // PIO progress: merged request being transferred, sector within it and sectors left for the command
+    BlockRequest *_pioRequest { NULL };
+    uint32_t _pioSector { 0 };
+    uint32_t _pioRemaining { 0 };
+
+    // Sectors transferred per DRQ block (and per IRQ) when using READ MULTIPLE, 0 if not enabled
+    uint8_t _sectorsPerDRQBlock { 0 };
+
+    // Bus master registers of the primary channel, 0 if DMA is not available
+    uint16_t _busMasterBase { 0 };
+};
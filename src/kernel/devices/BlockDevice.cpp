@@ -0,0 +1,264 @@
+#include <string.h>
+#include <x86/x86.h>
+#include <memLayout.h>
+#include <kernel/devices/BlockDevice.h>
+#include <kernel/fileSystem/FileDescription.h>
+
+/*
+ * Requests submitted at once by the synchronous reads
+ */
+#define SYNC_REQUESTS 16
+
+void BlockDevice::submit(BlockRequest& request) {
+  request.done = false;
+  request.success = false;
+  request.next = NULL;
+  request.merged = NULL;
+  request.totalCount = request.count;
+  request.segments = 1;
+
+  // May be called from an IRQ handler (e.g. a completion submitting the next request)
+  uint32_t flags = disableInterrupts();
+  if (!merge(request)) insert(request);
+  dispatch();
+  restoreInterrupts(flags);
+}
+
+bool BlockDevice::isDMABuffer(const void *buffer, uint32_t size) {
+  return !((uint32_t)buffer & 0x1) && isLinearMapped(buffer, size);
+}
+
+void BlockDevice::plug() {
+  uint32_t flags = disableInterrupts();
+  _plugged = true;
+  restoreInterrupts(flags);
+}
+
+void BlockDevice::unplug() {
+  uint32_t flags = disableInterrupts();
+  _plugged = false;
+  dispatch();
+  restoreInterrupts(flags);
+}
+
+/*
+ * Interrupts are enabled while halting, then put back as they were, so callers in interrupt gates keep them disabled
+ */
+void BlockDevice::wait(BlockRequest& request) {
+  uint32_t flags = disableInterrupts();
+  while (!request.done) asm volatile("sti\n hlt\n cli");
+  restoreInterrupts(flags);
+}
+
+/*
+ * Back merge: the request follows a queued one, it's added at the end of its chain
+ * Front merge: the request precedes a queued one, it takes its place in the queue and carries its chain
+ */
+bool BlockDevice::merge(BlockRequest& request) {
+  for (BlockRequest **link = &_queue; *link; link = &(*link)->next) {
+    BlockRequest *queued = *link;
+
+    if (queued->type != request.type) continue;
+    if (queued->totalCount + request.count > maxSectorsPerRequest()) continue;
+    if (queued->segments == BLOCK_MAX_SEGMENTS) continue;
+
+    if (queued->sector + queued->totalCount == request.sector) {
+      BlockRequest *tail = queued;
+      while (tail->merged) tail = tail->merged;
+
+      tail->merged = &request;
+      queued->totalCount += request.count;
+      queued->segments++;
+      return true;
+    }
+
+    if (request.sector + request.count == queued->sector) {
+      request.merged = queued;
+      request.totalCount += queued->totalCount;
+      request.segments += queued->segments;
+
+      request.next = queued->next;
+      queued->next = NULL;
+      *link = &request;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void BlockDevice::insert(BlockRequest& request) {
+  BlockRequest **link = &_queue;
+
+  while (*link && (*link)->sector <= request.sector) link = &(*link)->next;
+
+  request.next = *link;
+  *link = &request;
+}
+
+/*
+ * Start queued requests while the device takes them, using a C-LOOK elevator: the first request
+ * after the last started one, wrapping around to the lowest sector
+ */
+void BlockDevice::dispatch() {
+  // A backend may complete a request while it's being started
+  if (_dispatching || _plugged) return;
+  _dispatching = true;
+
+  bool started = false;
+
+  while (_queue && _inFlight < queueDepth()) {
+    BlockRequest **link = &_queue;
+
+    while (*link && (*link)->sector < _nextSector) link = &(*link)->next;
+    if (!*link) link = &_queue;
+
+    BlockRequest *request = *link;
+    *link = request->next;
+    request->next = NULL;
+
+    _inFlight++;
+    if (!startRequest(*request)) {
+      _inFlight--;
+      request->next = *link;
+      *link = request;
+      break;
+    }
+
+    _nextSector = request->sector + request->totalCount;
+    started = true;
+  }
+
+  if (started) endBatch();
+
+  _dispatching = false;
+}
+
+void BlockDevice::completeRequest(BlockRequest& request, bool success) {
+  BlockRequest *current = &request;
+
+  _inFlight--;
+
+  while (current) {
+    // The completion may reuse the request
+    BlockRequest *next = current->merged;
+
+    current->success = success;
+    current->done = true;
+    if (current->completion) current->completion(*current);
+
+    current = next;
+  }
+
+  dispatch();
+}
+
+bool BlockDevice::readSectors(uint8_t *destination, uint32_t sector, uint32_t count) {
+  return transfer(BLOCK_REQUEST_READ, destination, sector, count);
+}
+
+bool BlockDevice::writeSectors(const uint8_t *source, uint32_t sector, uint32_t count) {
+  return transfer(BLOCK_REQUEST_WRITE, (uint8_t *)source, sector, count);
+}
+
+/*
+ * Submit up to SYNC_REQUESTS requests of maxSectorsPerRequest() sectors and wait for all of them
+ */
+bool BlockDevice::transfer(BlockRequestType type, uint8_t *buffer, uint32_t sector, uint32_t count) {
+  BlockRequest requests[SYNC_REQUESTS];
+  bool success = true;
+
+  while (count) {
+    uint8_t submitted = 0;
+
+    while (count && submitted < SYNC_REQUESTS) {
+      uint32_t sectors = count < maxSectorsPerRequest() ? count : maxSectorsPerRequest();
+      BlockRequest& request = requests[submitted++];
+
+      memset(&request, 0x0, sizeof(BlockRequest));
+      request.type = type;
+      request.sector = sector;
+      request.count = sectors;
+      request.buffer = buffer;
+      submit(request);
+
+      buffer += sectors * SECTOR_SIZE;
+      sector += sectors;
+      count -= sectors;
+    }
+
+    for (uint8_t i = 0; i < submitted; i++) {
+      wait(requests[i]);
+      if (!requests[i].success) success = false;
+    }
+  }
+
+  return success;
+}
+
+size_t BlockDevice::read(FileDescription& description, uint8_t *buffer, size_t size) {
+  return pread(description, buffer, size, description.offset());
+}
+
+size_t BlockDevice::write(FileDescription& description, const uint8_t *buffer, size_t size) {
+  return pwrite(description, buffer, size, description.offset());
+}
+
+size_t BlockDevice::pread(FileDescription&, uint8_t *buffer, size_t size, uint32_t offset) {
+  uint8_t sectorBuffer[SECTOR_SIZE] __attribute__ ((aligned(SECTOR_SIZE))); // Within a page, for DMA
+  size_t transferred = 0;
+
+  while (transferred < size) {
+    uint32_t position = offset + transferred;
+    uint32_t offsetInSector = position % SECTOR_SIZE;
+
+    uint32_t count = (size - transferred) / SECTOR_SIZE;
+
+    // Whole sectors go straight to the device when it can use the caller's buffer
+    if (!offsetInSector && count && isDMABuffer(buffer + transferred, count * SECTOR_SIZE)) {
+      if (!readSectors(buffer + transferred, position / SECTOR_SIZE, count)) break;
+
+      transferred += count * SECTOR_SIZE;
+      continue;
+    }
+
+    size_t bytes = SECTOR_SIZE - offsetInSector < size - transferred ? SECTOR_SIZE - offsetInSector : size - transferred;
+    if (!readSectors(sectorBuffer, position / SECTOR_SIZE, 1)) break;
+
+    memcpy(buffer + transferred, sectorBuffer + offsetInSector, bytes);
+    transferred += bytes;
+  }
+
+  return transferred;
+}
+
+size_t BlockDevice::pwrite(FileDescription&, const uint8_t *buffer, size_t size, uint32_t offset) {
+  uint8_t sectorBuffer[SECTOR_SIZE] __attribute__ ((aligned(SECTOR_SIZE))); // Within a page, for DMA
+  size_t transferred = 0;
+
+  while (transferred < size) {
+    uint32_t position = offset + transferred;
+    uint32_t offsetInSector = position % SECTOR_SIZE;
+
+    uint32_t count = (size - transferred) / SECTOR_SIZE;
+
+    // Whole sectors go straight to the device when it can use the caller's buffer
+    if (!offsetInSector && count && isDMABuffer(buffer + transferred, count * SECTOR_SIZE)) {
+      if (!writeSectors(buffer + transferred, position / SECTOR_SIZE, count)) break;
+
+      transferred += count * SECTOR_SIZE;
+      continue;
+    }
+
+    // One sector through the sector buffer, the rest of a partial one is read first so it's written back unchanged
+    size_t bytes = SECTOR_SIZE - offsetInSector < size - transferred ? SECTOR_SIZE - offsetInSector : size - transferred;
+    if (bytes < SECTOR_SIZE && !readSectors(sectorBuffer, position / SECTOR_SIZE, 1)) break;
+
+    memcpy(sectorBuffer + offsetInSector, (void *)(buffer + transferred), bytes);
+    if (!writeSectors(sectorBuffer, position / SECTOR_SIZE, 1)) break;
+
+    transferred += bytes;
+  }
+
+  return transferred;
+}
@@ -0,0 +1,150 @@
+#pragma once
+#include <kernel/devices/Device.h>
+#include <kernel/fileSystem/fs.h>
+
+/*
+ * Most requests merged into a single device command
+ */
+#define BLOCK_MAX_SEGMENTS 8
+
+enum BlockRequestType : uint8_t {
+  BLOCK_REQUEST_READ = 0,
+  BLOCK_REQUEST_WRITE = 1,
+};
+
+/*
+ * Read or write of 'count' sectors starting at 'sector', from or into 'buffer'
+ * The request must stay alive until it completes
+ */
+struct BlockRequest {
+  BlockRequestType type;
+  uint32_t sector;
+  uint32_t count;
+  uint8_t *buffer;
+
+  // Called once the request completes, from the IRQ handler of the device
+  void (*completion)(BlockRequest& request);
+  void *context;
+
+  volatile bool done;
+  bool success;
+
+  // Managed by the device
+  BlockRequest *next; // Next request of the queue
+  BlockRequest *merged; // Next request (following sectors) to be transferred by the same command
+  uint32_t totalCount; // Sectors of this request and all the merged ones
+  uint8_t segments; // This request and all the merged ones
+};
+
+class BlockDevice : public Device {
+  public:
+    /*
+     * Queue the given request, which completes asynchronously ('done' is set and 'completion' is called)
+     * A request is merged with a queued one when their sectors are adjacent,
+     * the queue is served in ascending sector order
+     */
+    void submit(BlockRequest& request);
+
+    /*
+     * Hold the queued requests until unplug, so the requests submitted in between can be merged and sorted
+     * before any of them is started
+     */
+    void plug();
+    void unplug();
+
+    /*
+     * Halt until the given request completes
+     */
+    void wait(BlockRequest& request);
+
+    /*
+     * Whether the buffer can be given to the device as is for a DMA transfer: linear mapped (see isLinearMapped)
+     * and 2 byte aligned, as required by the PRD and AHCI PRDT entries
+     */
+    static bool isDMABuffer(const void *buffer, uint32_t size);
+
+    /*
+     * Read 'count' sectors starting from 'sector' and put them in 'destination', waiting for the data
+     * Virtual so the file system code shared with the prekernel doesn't link against it
+     */
+    virtual bool readSectors(uint8_t *destination, uint32_t sector, uint32_t count);
+
+    /*
+     * Write 'count' sectors from 'source' starting at 'sector', waiting for the disk to take them
+     */
+    virtual bool writeSectors(const uint8_t *source, uint32_t sector, uint32_t count);
+
+    /*
+     * Read or write the given file system block (SECTORS_PER_BLOCK sectors)
+     */
+    bool readBlock(uint8_t *destination, uint32_t block) {
+      return readSectors(destination, block * SECTORS_PER_BLOCK, SECTORS_PER_BLOCK);
+    }
+
+    bool writeBlock(const uint8_t *source, uint32_t block) {
+      return writeSectors(source, block * SECTORS_PER_BLOCK, SECTORS_PER_BLOCK);
+    }
+
+    /*
+     * Most sectors transferred by a single command
+     */
+    virtual uint32_t maxSectorsPerRequest() const = 0;
+
+    /*
+     * Most commands the device can have in flight at the same time
+     */
+    virtual uint8_t queueDepth() const { return 1; }
+
+    virtual bool canRead (FileDescription&) const override { return true; }
+    virtual bool canWrite (FileDescription&) const override { return true; }
+
+    /*
+     * Raw access to the device bytes at the offset of the description, without going through the buffer cache
+     * Whole sectors are transferred in place when the buffer can be used for DMA, the others go through a sector buffer
+     * (read-modify-write for partial sectors)
+     */
+    virtual size_t read(FileDescription&, uint8_t*, size_t) override;
+    virtual size_t write(FileDescription&, const uint8_t*, size_t) override;
+
+    /*
+     * Same as read and write, at the given offset of the device
+     */
+    virtual size_t pread(FileDescription&, uint8_t*, size_t, uint32_t offset) override;
+    virtual size_t pwrite(FileDescription&, const uint8_t*, size_t, uint32_t offset) override;
+
+  protected:
+    BlockDevice() : Device() {};
+
+    /*
+     * Start transferring the given request and the requests merged into it (one command)
+     * Returns false if the device can't take another command now, it will be retried after a completion
+     * Backends call completeRequest once the command is done, even if it failed
+     */
+    virtual bool startRequest(BlockRequest& request) = 0;
+
+    /*
+     * Called after one or more requests have been started, to let the device know about all of them at once
+     */
+    virtual void endBatch() {}
+
+    /*
+     * Complete the given request and the requests merged into it, then start the next queued ones
+     * Called with interrupts disabled
+     */
+    void completeRequest(BlockRequest& request, bool success);
+
+  private:
+    virtual bool isBlockDevice() const final { return true; }
+
+    bool transfer(BlockRequestType type, uint8_t *buffer, uint32_t sector, uint32_t count);
+
+    bool merge(BlockRequest& request);
+    void insert(BlockRequest& request);
+    void dispatch();
+
+    BlockRequest *_queue { NULL }; // Sorted by sector
+    uint32_t _nextSector { 0 }; // Sector following the last started request, for the elevator
+    uint8_t _inFlight { 0 };
+    bool _dispatching { false };
+    bool _plugged { false };
+};
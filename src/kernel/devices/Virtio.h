@@ -0,0 +1,90 @@
+#pragma once
+#include <stdint.h>
+
+/*
+ * Virtio legacy (0.9.5) PCI interface, as exposed by QEMU/KVM for "virtio-blk-pci" with disable-modern=on
+ * or by default for transitional devices
+ */
+
+#define VIRTIO_VENDOR_ID              0x1AF4
+#define VIRTIO_BLOCK_LEGACY_DEVICE_ID 0x1001
+
+/* Legacy registers, offsets from the I/O BAR0 */
+#define VIRTIO_DEVICE_FEATURES 0x00
+#define VIRTIO_GUEST_FEATURES  0x04
+#define VIRTIO_QUEUE_ADDRESS   0x08 // Physical page number of the selected queue
+#define VIRTIO_QUEUE_SIZE      0x0C
+#define VIRTIO_QUEUE_SELECT    0x0E
+#define VIRTIO_QUEUE_NOTIFY    0x10
+#define VIRTIO_DEVICE_STATUS   0x12
+#define VIRTIO_ISR_STATUS      0x13 // Reading it acknowledges the interrupt
+#define VIRTIO_DEVICE_CONFIG   0x14 // Device specific configuration when MSI-X is disabled
+
+/* Device status */
+#define VIRTIO_STATUS_ACKNOWLEDGE 0x1
+#define VIRTIO_STATUS_DRIVER      0x2
+#define VIRTIO_STATUS_DRIVER_OK   0x4
+#define VIRTIO_STATUS_FAILED      0x80
+
+#define VIRTIO_ISR_QUEUE 0x1 // Used ring updated
+
+/* Features */
+#define VIRTIO_RING_F_EVENT_IDX (1u << 29) // used_event and avail_event to suppress interrupts and notifications
+
+/* Virtqueue */
+#define VIRTQ_ALIGN 4096
+
+#define VIRTQ_DESC_F_NEXT  0x1 // The chain continues through 'next'
+#define VIRTQ_DESC_F_WRITE 0x2 // The device writes into the buffer
+
+#define VIRTQ_USED_F_NO_NOTIFY 0x1 // The device doesn't need to be notified
+
+typedef struct {
+  uint64_t address; // Physical address
+  uint32_t length;
+  uint16_t flags;
+  uint16_t next;
+} __attribute__ ((packed)) VirtqDescriptor;
+
+/*
+ * Followed by used_event (uint16_t) after 'ring[queue size]'
+ */
+typedef struct {
+  uint16_t flags;
+  uint16_t index;
+  uint16_t ring[];
+} __attribute__ ((packed)) VirtqAvailable;
+
+typedef struct {
+  uint32_t id; // Head of the completed descriptor chain
+  uint32_t length; // Bytes written by the device
+} __attribute__ ((packed)) VirtqUsedElement;
+
+/*
+ * Followed by avail_event (uint16_t) after 'ring[queue size]'
+ */
+typedef struct {
+  uint16_t flags;
+  uint16_t index;
+  VirtqUsedElement ring[];
+} __attribute__ ((packed)) VirtqUsed;
+
+/*
+ * Whether the other side asked to be notified when the index moves from 'oldIndex' to 'newIndex'
+ * 'eventIndex' is the index it wants to hear about (used_event or avail_event)
+ */
+static inline bool virtqNeedEvent(uint16_t eventIndex, uint16_t newIndex, uint16_t oldIndex) {
+  return (uint16_t)(newIndex - eventIndex - 1) < (uint16_t)(newIndex - oldIndex);
+}
+
+/* virtio-blk */
+#define VIRTIO_BLK_T_IN  0 // Read
+#define VIRTIO_BLK_T_OUT 1 // Write
+
+#define VIRTIO_BLK_S_OK 0
+
+typedef struct {
+  uint32_t type;
+  uint32_t reserved;
+  uint64_t sector;
+} __attribute__ ((packed)) VirtioBlockRequestHeader;
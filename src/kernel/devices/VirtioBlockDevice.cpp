@@ -0,0 +1,235 @@
+#include <io.h>
+#include <string.h>
+#include <mmu.h>
+#include <memLayout.h>
+#include <kernel/devices/VirtioBlockDevice.h>
+#include <kernel/interrupts/pic.h>
+#include <kernel/pci/pci.h>
+#include <kernel/utils/kprintf.h>
+
+/*
+ * Size of a legacy virtqueue of 'size' entries: descriptors and available ring, then the used ring on its own page
+ */
+#define VIRTQ_ALIGN_UP(x) (((x) + VIRTQ_ALIGN - 1) & ~(VIRTQ_ALIGN - 1))
+#define VIRTQ_USED_OFFSET(size) VIRTQ_ALIGN_UP(sizeof(VirtqDescriptor) * (size) + sizeof(uint16_t) * (3 + (size)))
+#define VIRTQ_BYTES(size) (VIRTQ_USED_OFFSET(size) + VIRTQ_ALIGN_UP(sizeof(uint16_t) * 3 + sizeof(VirtqUsedElement) * (size)))
+
+/*
+ * Memory shared with the device
+ * The header and status of a request are indexed by the head descriptor of its chain
+ */
+static uint8_t queueMemory[VIRTQ_BYTES(VIRTIO_MAX_QUEUE_SIZE)] __attribute__ ((aligned(VIRTQ_ALIGN)));
+static VirtioBlockRequestHeader requestHeaders[VIRTIO_MAX_QUEUE_SIZE];
+static volatile uint8_t requestStatuses[VIRTIO_MAX_QUEUE_SIZE];
+static BlockRequest *blockRequests[VIRTIO_MAX_QUEUE_SIZE];
+
+// Keep the compiler from reordering the ring updates, x86 doesn't reorder stores with other stores
+#define barrier() asm volatile("" : : : "memory")
+
+// We can only have one instance of VirtioBlockDevice
+static VirtioBlockDevice *s_the;
+
+VirtioBlockDevice* VirtioBlockDevice::create() {
+  PCI::Address address;
+
+  if (!PCI::findDeviceByID(VIRTIO_VENDOR_ID, VIRTIO_BLOCK_LEGACY_DEVICE_ID, address)) return NULL;
+
+  uint8_t irq = PCI::interruptLine(address);
+  if (irq >= 16) return NULL;
+
+  uint32_t bar = PCI::getBAR(address, 0);
+  if (!(bar & PCI_BAR_IO)) return NULL;
+
+  uint16_t ioBase = bar & PCI_BAR_IO_MASK;
+
+  // Only the first queue is used, its memory is reserved for up to VIRTIO_MAX_QUEUE_SIZE entries
+  IO::outw(ioBase + VIRTIO_QUEUE_SELECT, 0);
+  uint16_t queueSize = IO::inw(ioBase + VIRTIO_QUEUE_SIZE);
+  if (!queueSize || queueSize > VIRTIO_MAX_QUEUE_SIZE) return NULL;
+
+  PCI::enableBusMastering(address);
+
+  return new VirtioBlockDevice(ioBase, irq);
+}
+
+VirtioBlockDevice& VirtioBlockDevice::the() {
+  return *s_the;
+}
+
+VirtioBlockDevice::VirtioBlockDevice(uint16_t ioBase, uint8_t irq) : IRQHandler(irq), BlockDevice(), _ioBase(ioBase) {
+  s_the = this;
+
+  // Reset, then let the device know we found it and know how to drive it
+  IO::outb(_ioBase + VIRTIO_DEVICE_STATUS, 0);
+  IO::outb(_ioBase + VIRTIO_DEVICE_STATUS, VIRTIO_STATUS_ACKNOWLEDGE);
+  IO::outb(_ioBase + VIRTIO_DEVICE_STATUS, VIRTIO_STATUS_ACKNOWLEDGE | VIRTIO_STATUS_DRIVER);
+
+  uint32_t features = IO::inl(_ioBase + VIRTIO_DEVICE_FEATURES);
+  _eventIndex = features & VIRTIO_RING_F_EVENT_IDX;
+  IO::outl(_ioBase + VIRTIO_GUEST_FEATURES, features & VIRTIO_RING_F_EVENT_IDX);
+
+  initializeQueue();
+
+  _capacity = IO::inl(_ioBase + VIRTIO_DEVICE_CONFIG) | ((uint64_t)IO::inl(_ioBase + VIRTIO_DEVICE_CONFIG + 4) << 32);
+
+  IO::outb(_ioBase + VIRTIO_DEVICE_STATUS, VIRTIO_STATUS_ACKNOWLEDGE | VIRTIO_STATUS_DRIVER | VIRTIO_STATUS_DRIVER_OK);
+
+  if (irq >= 8) PIC::enable(PIC_IRQ_CASCADE);
+  enableIRQ();
+
+  kprintf("virtio-blk: %llu sectors, irq %d, queue size %d, event index %s\n", _capacity, irq, _queueSize, _eventIndex ? "on" : "off");
+}
+
+void VirtioBlockDevice::initializeQueue() {
+  IO::outw(_ioBase + VIRTIO_QUEUE_SELECT, 0);
+
+  uint16_t size = IO::inw(_ioBase + VIRTIO_QUEUE_SIZE);
+
+  memset(queueMemory, 0x0, sizeof(queueMemory));
+
+  _queueSize = size;
+  _descriptors = (VirtqDescriptor *)queueMemory;
+  _available = (VirtqAvailable *)(queueMemory + sizeof(VirtqDescriptor) * size);
+  _used = (volatile VirtqUsed *)(queueMemory + VIRTQ_USED_OFFSET(size));
+
+  // Every descriptor starts in the free list
+  for (uint16_t i = 0; i < size; i++) _descriptors[i].next = i + 1;
+  _freeHead = 0;
+  _freeCount = size;
+
+  IO::outl(_ioBase + VIRTIO_QUEUE_ADDRESS, physicalAddressOf(queueMemory) / VIRTQ_ALIGN);
+}
+
+uint16_t VirtioBlockDevice::allocateDescriptor() {
+  uint16_t descriptor = _freeHead;
+
+  _freeHead = _descriptors[descriptor].next;
+  _freeCount--;
+
+  return descriptor;
+}
+
+void VirtioBlockDevice::freeChain(uint16_t head) {
+  uint16_t descriptor = head;
+
+  for (;;) {
+    uint16_t flags = _descriptors[descriptor].flags;
+    uint16_t next = _descriptors[descriptor].next;
+
+    _descriptors[descriptor].next = _freeHead;
+    _freeHead = descriptor;
+    _freeCount++;
+
+    if (!(flags & VIRTQ_DESC_F_NEXT)) break;
+    descriptor = next;
+  }
+}
+
+/*
+ * A request is a chain of descriptors: the header (read by the device), the data buffers (a descriptor per
+ * physically contiguous run of pages of every merged request) and the status byte (written by the device)
+ * It's only added to the available ring, endBatch() publishes it
+ */
+bool VirtioBlockDevice::startRequest(BlockRequest& request) {
+  bool write = request.type == BLOCK_REQUEST_WRITE;
+  uint32_t pages = 0;
+  for (BlockRequest *segment = &request; segment; segment = segment->merged)
+    pages += (((uint32_t)segment->buffer & (PAGE_SIZE - 1)) + segment->count * SECTOR_SIZE + PAGE_SIZE - 1) / PAGE_SIZE;
+
+  if (_freeCount < pages + 2) return false;
+
+  uint16_t head = allocateDescriptor();
+
+  requestHeaders[head].type = write ? VIRTIO_BLK_T_OUT : VIRTIO_BLK_T_IN;
+  requestHeaders[head].reserved = 0;
+  requestHeaders[head].sector = request.sector;
+  requestStatuses[head] = 0xFF;
+  blockRequests[head] = &request;
+
+  _descriptors[head].address = physicalAddressOf(&requestHeaders[head]);
+  _descriptors[head].length = sizeof(VirtioBlockRequestHeader);
+  _descriptors[head].flags = 0;
+
+  uint16_t previous = head;
+
+  for (BlockRequest *segment = &request; segment; segment = segment->merged) {
+    uint8_t *buffer = segment->buffer;
+    uint32_t bytes = segment->count * SECTOR_SIZE;
+
+    while (bytes) {
+      uint32_t size = PAGE_SIZE - ((uint32_t)buffer & (PAGE_SIZE - 1));
+      if (size > bytes) size = bytes;
+
+      uint32_t physicalAddress = physicalAddressOf(buffer);
+
+      if (previous != head && _descriptors[previous].address + _descriptors[previous].length == physicalAddress) {
+        _descriptors[previous].length += size;
+      } else {
+        uint16_t descriptor = allocateDescriptor();
+
+        _descriptors[descriptor].address = physicalAddress;
+        _descriptors[descriptor].length = size;
+        // The device only writes the data buffers of a read
+        _descriptors[descriptor].flags = write ? 0 : VIRTQ_DESC_F_WRITE;
+
+        _descriptors[previous].flags |= VIRTQ_DESC_F_NEXT;
+        _descriptors[previous].next = descriptor;
+        previous = descriptor;
+      }
+
+      buffer += size;
+      bytes -= size;
+    }
+  }
+
+  uint16_t status = allocateDescriptor();
+
+  _descriptors[status].address = physicalAddressOf((void *)&requestStatuses[head]);
+  _descriptors[status].length = sizeof(uint8_t);
+  _descriptors[status].flags = VIRTQ_DESC_F_WRITE;
+
+  _descriptors[previous].flags |= VIRTQ_DESC_F_NEXT;
+  _descriptors[previous].next = status;
+
+  _available->ring[_nextAvailableIndex % _queueSize] = head;
+  _nextAvailableIndex++;
+  _inFlight++;
+
+  return true;
+}
+
+void VirtioBlockDevice::endBatch() {
+  // Only interrupt once every request in flight has completed
+  if (_eventIndex) _available->ring[_queueSize] = _lastUsedIndex + _inFlight - 1;
+
+  barrier();
+  _available->index = _nextAvailableIndex;
+  barrier();
+
+  bool notify;
+  if (_eventIndex) notify = virtqNeedEvent(*(volatile uint16_t *)&_used->ring[_queueSize], _nextAvailableIndex, _lastKickIndex);
+  else notify = !(_used->flags & VIRTQ_USED_F_NO_NOTIFY);
+
+  _lastKickIndex = _nextAvailableIndex;
+
+  if (notify) IO::outw(_ioBase + VIRTIO_QUEUE_NOTIFY, 0);
+}
+
+void VirtioBlockDevice::handleIRQ() {
+  if (!(IO::inb(_ioBase + VIRTIO_ISR_STATUS) & VIRTIO_ISR_QUEUE)) return;
+
+  while (_lastUsedIndex != _used->index) {
+    barrier();
+
+    uint16_t head = _used->ring[_lastUsedIndex % _queueSize].id;
+    BlockRequest *request = blockRequests[head];
+    bool success = requestStatuses[head] == VIRTIO_BLK_S_OK;
+
+    blockRequests[head] = NULL;
+    freeChain(head);
+    _inFlight--;
+    _lastUsedIndex++;
+
+    completeRequest(*request, success);
+  }
+}
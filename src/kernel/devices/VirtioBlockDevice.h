@@ -0,0 +1,74 @@
+#pragma once
+#include <kernel/devices/BlockDevice.h>
+#include <kernel/devices/Virtio.h>
+#include <kernel/interrupts/IRQHandler.h>
+
+/*
+ * Largest queue supported, the virtqueue memory is reserved statically
+ */
+#define VIRTIO_MAX_QUEUE_SIZE 256
+
+#define VIRTIO_BLK_MAX_SECTORS_PER_REQUEST 128
+
+#define VIRTIO_MAX_REQUESTS_IN_FLIGHT 64
+
+/*
+ * Virtio block device (legacy PCI interface)
+ * Requests are added to the virtqueue in batches, the device is notified once per batch,
+ * and with VIRTIO_RING_F_EVENT_IDX it only interrupts once every request in flight completes
+ */
+class VirtioBlockDevice final : public IRQHandler, public BlockDevice {
+  public:
+    /*
+     * Look for a virtio block device, returns NULL if there is none
+     */
+    static VirtioBlockDevice* create();
+
+    static VirtioBlockDevice& the();
+
+    virtual uint32_t maxSectorsPerRequest() const override { return VIRTIO_BLK_MAX_SECTORS_PER_REQUEST; }
+
+    // Bounded by the free descriptors, startRequest refuses requests once they run out
+    virtual uint8_t queueDepth() const override { return VIRTIO_MAX_REQUESTS_IN_FLIGHT; }
+
+  private:
+    VirtioBlockDevice(uint16_t ioBase, uint8_t irq);
+
+    virtual void handleIRQ() override;
+
+    /*
+     * Set up the first virtqueue, its size has already been checked by create()
+     */
+    void initializeQueue();
+
+    /*
+     * Add the request to the available ring, without publishing it to the device yet
+     * Returns false if there are not enough free descriptors
+     */
+    virtual bool startRequest(BlockRequest& request) override;
+
+    /*
+     * Publish the started requests and notify the device, unless it said it doesn't need it
+     */
+    virtual void endBatch() override;
+
+    uint16_t allocateDescriptor();
+    void freeChain(uint16_t head);
+
+    uint16_t _ioBase;
+    uint16_t _queueSize { 0 };
+    bool _eventIndex { false };
+    uint64_t _capacity { 0 }; // In sectors
+
+    VirtqDescriptor *_descriptors { NULL };
+    VirtqAvailable *_available { NULL };
+    volatile VirtqUsed *_used { NULL };
+
+    uint16_t _freeHead { 0 };
+    uint16_t _freeCount { 0 };
+
+    uint16_t _nextAvailableIndex { 0 }; // Next entry of the available ring to fill
+    uint16_t _lastKickIndex { 0 }; // Available index the device was last told about
+    uint16_t _lastUsedIndex { 0 }; // Next entry of the used ring to process
+    uint16_t _inFlight { 0 };
+};
@@ -0,0 +1,87 @@
+#include <string.h>
+#include <kernel/fileSystem/BlockAllocator.h>
+#include <kernel/fileSystem/BufferCache.h>
+#include <kernel/fileSystem/blockBitmap.h>
+#include <kernel/devices/BlockDevice.h>
+
+#define BITS_PER_BLOCK (BLOCK_SIZE * 8)
+
+static BlockAllocator *_instance;
+
+BlockAllocator* BlockAllocator::create(BlockDevice& device, const struct superBlock& superBlock) {
+  if (superBlock.totalNumberOfDataBlocks <= superBlock.firstDataBlock) return NULL;
+  if (superBlock.dataBlocksBitmapBlocks * BITS_PER_BLOCK < superBlock.totalNumberOfDataBlocks) return NULL;
+
+  uint8_t *bitmap = new uint8_t[superBlock.dataBlocksBitmapBlocks * BLOCK_SIZE];
+
+  for (uint32_t i = 0; i < superBlock.dataBlocksBitmapBlocks; i++) {
+    Buffer *buffer = BufferCache::instance().get(device, superBlock.firstDataBlocksBitmapBlock + i);
+
+    if (!buffer) {
+      delete[] bitmap;
+      return NULL;
+    }
+
+    memcpy(bitmap + i * BLOCK_SIZE, buffer->data, BLOCK_SIZE);
+    BufferCache::instance().release(buffer);
+  }
+
+  return new BlockAllocator(device, superBlock, bitmap);
+}
+
+BlockAllocator::BlockAllocator(BlockDevice& device, const struct superBlock& superBlock, uint8_t *bitmap)
+  : _device(device),
+    _firstBitmapBlock(superBlock.firstDataBlocksBitmapBlock),
+    _firstDataBlock(superBlock.firstDataBlock),
+    _totalBlocks(superBlock.totalNumberOfDataBlocks),
+    _bitmap(bitmap) {
+  _instance = this;
+
+  for (uint32_t block = _firstDataBlock; block < _totalBlocks; block++)
+    if (!blockBitmapTest(_bitmap, block)) _freeBlocks++;
+}
+
+BlockAllocator& BlockAllocator::instance() {
+  return *_instance;
+}
+
+bool BlockAllocator::exists() {
+  return _instance;
+}
+
+uint32_t BlockAllocator::allocate(uint32_t goal, uint32_t count, uint32_t& allocated) {
+  uint32_t block = blockBitmapFindRun(_bitmap, _firstDataBlock, _totalBlocks, goal, count, &allocated);
+  if (!allocated) return 0;
+
+  blockBitmapSet(_bitmap, block, allocated);
+  _freeBlocks -= allocated;
+  writeBack(block, allocated);
+
+  return block;
+}
+
+void BlockAllocator::free(uint32_t block, uint32_t count) {
+  if (block < _firstDataBlock || block + count > _totalBlocks) return;
+
+  blockBitmapClear(_bitmap, block, count);
+  _freeBlocks += count;
+  writeBack(block, count);
+}
+
+uint32_t BlockAllocator::groupGoal(uint32_t directory) const {
+  return blockGroupGoal(_firstDataBlock, _totalBlocks, directory);
+}
+
+void BlockAllocator::writeBack(uint32_t block, uint32_t count) {
+  uint32_t first = block / BITS_PER_BLOCK;
+  uint32_t last = (block + count - 1) / BITS_PER_BLOCK;
+
+  for (uint32_t i = first; i <= last; i++) {
+    Buffer *buffer = BufferCache::instance().get(_device, _firstBitmapBlock + i);
+    if (!buffer) continue;
+
+    memcpy(buffer->data, _bitmap + i * BLOCK_SIZE, BLOCK_SIZE);
+    BufferCache::instance().markDirty(buffer);
+    BufferCache::instance().release(buffer);
+  }
+}
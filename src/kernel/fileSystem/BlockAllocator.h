@@ -0,0 +1,61 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <kernel/fileSystem/fs.h>
+
+class BlockDevice;
+
+#define PREALLOCATION_BLOCKS 8 // Blocks reserved at once for a growing file
+
+/*
+ * Data block allocator working on the data blocks bitmap of the file system
+ * The bitmap is kept in memory for the searches, every change is also made to its blocks in the buffer cache
+ * so it's written back with them
+ *
+ * Allocations look for contiguous runs near a goal block: right after the previous block of the file,
+ * or the locality group of the directory for a file without blocks
+ */
+class BlockAllocator {
+  public:
+    /*
+     * Read the data blocks bitmap described by the super block, returns NULL if it can't be read
+     */
+    static BlockAllocator* create(BlockDevice& device, const struct superBlock& superBlock);
+
+    static BlockAllocator& instance();
+
+    /*
+     * Whether the allocator has been created, the file system is read only without it
+     */
+    static bool exists();
+
+    /*
+     * Allocate up to 'count' contiguous blocks, as close to 'goal' as possible
+     * Returns the first block, 'allocated' is set to the number of blocks allocated (0 if the disk is full)
+     */
+    uint32_t allocate(uint32_t goal, uint32_t count, uint32_t& allocated);
+
+    void free(uint32_t block, uint32_t count);
+
+    /*
+     * First block of the locality group of the given directory
+     */
+    uint32_t groupGoal(uint32_t directory) const;
+
+    uint32_t freeBlocks() const { return _freeBlocks; }
+
+  private:
+    BlockAllocator(BlockDevice& device, const struct superBlock& superBlock, uint8_t *bitmap);
+
+    /*
+     * Copy the bitmap bytes covering the given blocks into the bitmap blocks of the buffer cache
+     */
+    void writeBack(uint32_t block, uint32_t count);
+
+    BlockDevice& _device;
+    uint32_t _firstBitmapBlock;
+    uint32_t _firstDataBlock;
+    uint32_t _totalBlocks;
+    uint32_t _freeBlocks { 0 };
+    uint8_t *_bitmap;
+};
@@ -0,0 +1,387 @@
+#include <string.h>
+#include <mmu.h>
+#include <x86/x86.h>
+#include <kernel/fileSystem/BufferCache.h>
+#include <kernel/devices/BlockDevice.h>
+#include <kernel/utils/kprintf.h>
+
+static BufferCache *_instance;
+
+/*
+ * Block data lives in the kernel image, so it's physically contiguous and can be used for DMA
+ */
+static uint8_t bufferData[BUFFER_CACHE_BUFFERS][BLOCK_SIZE] __attribute__ ((aligned(PAGE_SIZE)));
+
+static inline uint32_t bucketOf(BlockDevice& device, uint32_t block) {
+  return (block ^ ((uint32_t)&device >> 4)) & (BUFFER_CACHE_BUCKETS - 1);
+}
+
+BufferCache::BufferCache() {
+  _instance = this;
+
+  memset(_buckets, 0x0, sizeof(_buckets));
+  memset(_buffers, 0x0, sizeof(_buffers));
+
+  for (uint32_t i = 0; i < BUFFER_CACHE_BUFFERS; i++) {
+    _buffers[i].data = bufferData[i];
+    moveToBack(&_buffers[i]);
+  }
+}
+
+BufferCache& BufferCache::instance() {
+  return *_instance;
+}
+
+/*
+ * The cache is also used by the completion of the requests from the device IRQ, so it's only modified with
+ * interrupts disabled
+ * Interrupts are enabled again before waiting for the device
+ */
+Buffer* BufferCache::get(BlockDevice& device, uint32_t block) {
+  uint32_t flags = disableInterrupts();
+  Buffer *buffer = lookup(device, block);
+
+  if (buffer) {
+    buffer->references++;
+    moveToFront(buffer);
+    restoreInterrupts(flags);
+
+    // Still being read, wait for it rather than reading it again
+    if (buffer->busy && !buffer->valid) device.wait(buffer->request);
+
+    if (buffer->prefetched) {
+      buffer->prefetched = false;
+      if (buffer->valid) _prefetchHits++;
+    }
+
+    if (buffer->valid) {
+      _hits++;
+      return buffer;
+    }
+
+    // The prefetch failed, read it again
+    if (!device.readBlock(buffer->data, block)) {
+      release(buffer);
+      return NULL;
+    }
+
+    buffer->valid = true;
+    return buffer;
+  }
+
+  _misses++;
+
+  buffer = reuse(device, block);
+  if (!buffer) {
+    // Every buffer is dirty or in use, make room by writing them back
+    restoreInterrupts(flags);
+    sync();
+    flags = disableInterrupts();
+
+    // The block may have been read meanwhile
+    if (lookup(device, block)) {
+      restoreInterrupts(flags);
+      return get(device, block);
+    }
+
+    buffer = reuse(device, block);
+    if (!buffer) {
+      restoreInterrupts(flags);
+      return NULL;
+    }
+  }
+
+  buffer->references = 1;
+  restoreInterrupts(flags);
+
+  if (!device.readBlock(buffer->data, block)) {
+    flags = disableInterrupts();
+    buffer->references = 0;
+    moveToBack(buffer);
+    restoreInterrupts(flags);
+    return NULL;
+  }
+
+  flags = disableInterrupts();
+  buffer->valid = true;
+  hash(buffer);
+  moveToFront(buffer);
+  restoreInterrupts(flags);
+
+  return buffer;
+}
+
+Buffer* BufferCache::getZeroed(BlockDevice& device, uint32_t block) {
+  uint32_t flags = disableInterrupts();
+  Buffer *buffer = lookup(device, block);
+
+  if (buffer) {
+    buffer->references++;
+    restoreInterrupts(flags);
+
+    // A stale read of the block may still be in flight
+    if (buffer->busy && !buffer->valid) device.wait(buffer->request);
+  } else {
+    buffer = reuse(device, block);
+
+    if (!buffer) {
+      restoreInterrupts(flags);
+      sync();
+      flags = disableInterrupts();
+
+      buffer = reuse(device, block);
+      if (!buffer) {
+        restoreInterrupts(flags);
+        return NULL;
+      }
+    }
+
+    buffer->references = 1;
+    hash(buffer);
+    restoreInterrupts(flags);
+  }
+
+  memset(buffer->data, 0x0, BLOCK_SIZE);
+  buffer->valid = true;
+  buffer->prefetched = false;
+  buffer->dirty = true;
+
+  flags = disableInterrupts();
+  moveToFront(buffer);
+  restoreInterrupts(flags);
+
+  return buffer;
+}
+
+/*
+ * The buffer is hashed right away, so a get() of the same block waits for this read instead of issuing another one
+ */
+bool BufferCache::prefetch(BlockDevice& device, uint32_t block) {
+  uint32_t flags = disableInterrupts();
+
+  if (lookup(device, block)) {
+    restoreInterrupts(flags);
+    return true;
+  }
+
+  Buffer *buffer = reuse(device, block);
+  if (!buffer) {
+    restoreInterrupts(flags);
+    return false;
+  }
+
+  _prefetches++;
+
+  memset(&buffer->request, 0x0, sizeof(BlockRequest));
+  buffer->request.type = BLOCK_REQUEST_READ;
+  buffer->request.sector = block * SECTORS_PER_BLOCK;
+  buffer->request.count = SECTORS_PER_BLOCK;
+  buffer->request.buffer = buffer->data;
+  buffer->request.completion = prefetchCompleted;
+  buffer->request.context = buffer;
+
+  buffer->busy = true;
+  buffer->prefetched = true;
+  hash(buffer);
+  moveToFront(buffer);
+
+  device.submit(buffer->request);
+  restoreInterrupts(flags);
+
+  return true;
+}
+
+/*
+ * Called from the IRQ handler of the device
+ */
+void BufferCache::prefetchCompleted(BlockRequest& request) {
+  Buffer *buffer = (Buffer *)request.context;
+
+  buffer->valid = request.success;
+  buffer->busy = false;
+}
+
+void BufferCache::release(Buffer *buffer) {
+  uint32_t flags = disableInterrupts();
+  if (buffer && buffer->references) buffer->references--;
+  restoreInterrupts(flags);
+}
+
+void BufferCache::markDirty(Buffer *buffer) {
+  buffer->dirty = true;
+}
+
+/*
+ * The dirty flag is cleared once the write is submitted, so a buffer modified while being written
+ * is written again by the next flush
+ */
+void BufferCache::flush(bool all) {
+  uint32_t flags = disableInterrupts();
+  BlockDevice *plugged[BUFFER_CACHE_BUFFERS];
+  uint32_t devices = 0;
+
+  for (uint32_t i = 0; i < BUFFER_CACHE_BUFFERS; i++) {
+    Buffer *buffer = &_buffers[i];
+
+    if (!buffer->dirty || buffer->busy || !buffer->valid) continue;
+    if (buffer->references && !all) continue;
+
+    uint32_t device = 0;
+    while (device < devices && plugged[device] != buffer->device) device++;
+    if (device == devices) {
+      plugged[devices++] = buffer->device;
+      buffer->device->plug();
+    }
+
+    memset(&buffer->request, 0x0, sizeof(BlockRequest));
+    buffer->request.type = BLOCK_REQUEST_WRITE;
+    buffer->request.sector = buffer->block * SECTORS_PER_BLOCK;
+    buffer->request.count = SECTORS_PER_BLOCK;
+    buffer->request.buffer = buffer->data;
+    buffer->request.completion = writeCompleted;
+    buffer->request.context = buffer;
+
+    buffer->dirty = false;
+    buffer->busy = true;
+    _writes++;
+
+    buffer->device->submit(buffer->request);
+  }
+
+  for (uint32_t device = 0; device < devices; device++) plugged[device]->unplug();
+
+  restoreInterrupts(flags);
+}
+
+void BufferCache::sync() {
+  flush(true);
+
+  for (uint32_t i = 0; i < BUFFER_CACHE_BUFFERS; i++) {
+    Buffer *buffer = &_buffers[i];
+
+    uint32_t flags = disableInterrupts();
+    while (buffer->busy) asm volatile("sti\n hlt\n cli");
+    restoreInterrupts(flags);
+  }
+}
+
+/*
+ * Called from the IRQ handler of the device, a failed write is kept dirty to be retried
+ */
+void BufferCache::writeCompleted(BlockRequest& request) {
+  Buffer *buffer = (Buffer *)request.context;
+
+  if (!request.success) {
+    buffer->dirty = true;
+    _instance->_writeErrors++;
+  }
+  buffer->busy = false;
+}
+
+/*
+ * Called from the PIT IRQ handler, before the cache exists too
+ */
+void BufferCache::onTick() {
+  if (!_instance) return;
+  if (++_instance->_ticks < BUFFER_CACHE_FLUSH_TICKS) return;
+
+  _instance->_ticks = 0;
+  _instance->_flushDue = true;
+}
+
+void BufferCache::flushIfDue() {
+  if (!_instance || !_instance->_flushDue) return;
+
+  _instance->_flushDue = false;
+  _instance->flush();
+}
+
+Buffer* BufferCache::lookup(BlockDevice& device, uint32_t block) {
+  for (Buffer *buffer = _buckets[bucketOf(device, block)]; buffer; buffer = buffer->hashNext)
+    if (buffer->device == &device && buffer->block == block) return buffer;
+
+  return NULL;
+}
+
+Buffer* BufferCache::reuse(BlockDevice& device, uint32_t block) {
+  Buffer *buffer = _lruTail;
+
+  while (buffer && (buffer->references || buffer->dirty || buffer->busy)) buffer = buffer->lruPrevious;
+  if (!buffer) return NULL;
+
+  if (buffer->device) {
+    unhash(buffer);
+    if (buffer->valid) _evictions++;
+  }
+
+  buffer->device = &device;
+  buffer->block = block;
+  buffer->valid = false;
+  buffer->prefetched = false;
+
+  return buffer;
+}
+
+void BufferCache::hash(Buffer *buffer) {
+  Buffer **bucket = &_buckets[bucketOf(*buffer->device, buffer->block)];
+
+  buffer->hashNext = *bucket;
+  *bucket = buffer;
+}
+
+void BufferCache::unhash(Buffer *buffer) {
+  for (Buffer **link = &_buckets[bucketOf(*buffer->device, buffer->block)]; *link; link = &(*link)->hashNext) {
+    if (*link != buffer) continue;
+
+    *link = buffer->hashNext;
+    buffer->hashNext = NULL;
+    return;
+  }
+}
+
+void BufferCache::unlink(Buffer *buffer) {
+  if (buffer->lruPrevious) buffer->lruPrevious->lruNext = buffer->lruNext;
+  else if (_lruHead == buffer) _lruHead = buffer->lruNext;
+
+  if (buffer->lruNext) buffer->lruNext->lruPrevious = buffer->lruPrevious;
+  else if (_lruTail == buffer) _lruTail = buffer->lruPrevious;
+
+  buffer->lruPrevious = NULL;
+  buffer->lruNext = NULL;
+}
+
+void BufferCache::moveToFront(Buffer *buffer) {
+  unlink(buffer);
+
+  buffer->lruNext = _lruHead;
+  if (_lruHead) _lruHead->lruPrevious = buffer;
+  _lruHead = buffer;
+  if (!_lruTail) _lruTail = buffer;
+}
+
+void BufferCache::moveToBack(Buffer *buffer) {
+  unlink(buffer);
+
+  buffer->lruPrevious = _lruTail;
+  if (_lruTail) _lruTail->lruNext = buffer;
+  _lruTail = buffer;
+  if (!_lruHead) _lruHead = buffer;
+}
+
+void BufferCache::dump() {
+  uint32_t cached = 0;
+  uint32_t referenced = 0;
+  uint32_t dirty = 0;
+
+  for (uint32_t i = 0; i < BUFFER_CACHE_BUFFERS; i++) {
+    if (_buffers[i].valid) cached++;
+    if (_buffers[i].references) referenced++;
+    if (_buffers[i].dirty) dirty++;
+  }
+
+  kprintf("\n=== Buffer cache ===");
+  kprintf("\nbuffers: %d, cached: %d, referenced: %d, dirty: %d", BUFFER_CACHE_BUFFERS, cached, referenced, dirty);
+  kprintf("\nhits: %d, misses: %d, evictions: %d", _hits, _misses, _evictions);
+  kprintf("\nprefetches: %d, prefetch hits: %d", _prefetches, _prefetchHits);
+  kprintf("\nwrites: %d, write errors: %d\n", _writes, _writeErrors);
+}
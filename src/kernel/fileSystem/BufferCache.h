@@ -0,0 +1,133 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <kernel/fileSystem/fs.h>
+#include <kernel/devices/BlockDevice.h>
+#include <kernel/interrupts/pic.h>
+
+#define BUFFER_CACHE_BUFFERS 64 // 256 KiB of cached blocks
+#define BUFFER_CACHE_BUCKETS 32 // Must be a power of 2
+#define BUFFER_CACHE_FLUSH_TICKS (5 * PIT_TICK_FREQUENCY) // Write the dirty buffers back every 5 seconds
+
+/*
+ * File system block cached in memory
+ */
+struct Buffer {
+  BlockDevice *device;
+  uint32_t block;
+  uint8_t *data; // BLOCK_SIZE bytes
+
+  uint16_t references; // Users holding the buffer, it's never evicted while referenced
+  volatile bool valid; // The data has been read from the device
+  volatile bool busy; // Being read or written asynchronously, set back by the completion of 'request'
+  volatile bool dirty; // The data has been modified and must be written back before being evicted
+  bool prefetched; // Read ahead and not used yet
+
+  BlockRequest request; // Asynchronous read (prefetch) or write back
+
+  Buffer *hashNext; // Next buffer in the same hash bucket
+  Buffer *lruPrevious; // Least recently used list, the head is the most recently used buffer
+  Buffer *lruNext;
+};
+
+/*
+ * Cache of file system blocks keyed by (device, block number)
+ * Lookups go through a hash table, the least recently used unreferenced buffer is reused on a miss
+ *
+ * Writes only modify the cached block (write-back), dirty buffers are written to the device
+ * by the periodic flush, by sync() or when every buffer is dirty
+ * The periodic flush is only requested by the PIT IRQ, the device may be busy-waited (PIO) so it runs outside of it
+ */
+class BufferCache {
+  public:
+    BufferCache();
+    static BufferCache& instance();
+
+    /*
+     * Get the given block, reading it from the device if it's not cached
+     * The buffer stays referenced until it's released
+     * Returns NULL if the block can't be read or every buffer is in use
+     * Must not be called from an IRQ handler, it may wait for the device
+     */
+    Buffer* get(BlockDevice& device, uint32_t block);
+
+    /*
+     * Get the given block filled with zeros, without reading it, for a block just allocated
+     * The buffer is dirty and stays referenced until it's released
+     */
+    Buffer* getZeroed(BlockDevice& device, uint32_t block);
+
+    void release(Buffer *buffer);
+
+    /*
+     * Start reading the given block in the background if it's not cached, without waiting for it
+     * Returns false if the block could not be queued (every buffer in use)
+     */
+    bool prefetch(BlockDevice& device, uint32_t block);
+
+    /*
+     * Mark the buffer as modified, it won't be evicted until it's written back
+     */
+    void markDirty(Buffer *buffer);
+
+    /*
+     * Start writing back the dirty buffers without waiting for them
+     * Referenced buffers may still be modified by their users, they are only written if 'all' is set
+     * The writes are submitted with the devices plugged, so adjacent blocks are merged into a single command
+     */
+    void flush(bool all = false);
+
+    /*
+     * Write back every dirty buffer and wait until they are all on the device
+     */
+    void sync();
+
+    /*
+     * Called on every PIT tick, requests a flush every BUFFER_CACHE_FLUSH_TICKS ticks
+     */
+    static void onTick();
+
+    /*
+     * Flush if the PIT requested it, called when the kernel is idle (waiting in poll)
+     * Must not be called from an IRQ handler
+     */
+    static void flushIfDue();
+
+    /*
+     * Print the hit, miss and eviction counters
+     */
+    void dump();
+
+  private:
+    Buffer* lookup(BlockDevice& device, uint32_t block);
+
+    /*
+     * Least recently used buffer not referenced, not dirty and not busy, NULL if there is none
+     * The buffer is unhashed and ready to hold the given block
+     */
+    Buffer* reuse(BlockDevice& device, uint32_t block);
+
+    static void prefetchCompleted(BlockRequest& request);
+    static void writeCompleted(BlockRequest& request);
+
+    void hash(Buffer *buffer);
+    void unhash(Buffer *buffer);
+    void moveToFront(Buffer *buffer);
+    void moveToBack(Buffer *buffer);
+    void unlink(Buffer *buffer);
+
+    Buffer _buffers[BUFFER_CACHE_BUFFERS];
+    Buffer *_buckets[BUFFER_CACHE_BUCKETS];
+    Buffer *_lruHead { NULL };
+    Buffer *_lruTail { NULL };
+
+    uint32_t _hits { 0 };
+    uint32_t _misses { 0 };
+    uint32_t _evictions { 0 };
+    uint32_t _prefetches { 0 };
+    uint32_t _prefetchHits { 0 }; // Gets served by a prefetched block
+    uint32_t _writes { 0 };
+    uint32_t _writeErrors { 0 };
+    uint32_t _ticks { 0 };
+    volatile bool _flushDue { false };
+};
@@ -0,0 +1,154 @@
+#include <string.h>
+#include <kernel/fileSystem/DentryCache.h>
+#include <kernel/utils/kprintf.h>
+
+static DentryCache *_instance;
+
+/*
+ * FNV-1a hash of the name, seeded with the parent inode number
+ */
+static uint32_t hashOf(uint32_t parent, const char *name, uint32_t length) {
+  uint32_t hash = 2166136261u ^ parent;
+
+  for (uint32_t i = 0; i < length; i++) {
+    hash ^= (uint8_t)name[i];
+    hash *= 16777619u;
+  }
+
+  return hash;
+}
+
+DentryCache::DentryCache() {
+  _instance = this;
+
+  memset(_buckets, 0x0, sizeof(_buckets));
+  memset(_entries, 0x0, sizeof(_entries));
+
+  for (uint32_t i = 0; i < DENTRY_CACHE_ENTRIES; i++) moveToBack(&_entries[i]);
+}
+
+DentryCache& DentryCache::instance() {
+  return *_instance;
+}
+
+bool DentryCache::lookup(uint32_t parent, const char *name, uint32_t length, uint32_t& inodeNumber) {
+  Dentry *dentry = find(parent, name, length, hashOf(parent, name, length));
+
+  if (!dentry) {
+    _misses++;
+    return false;
+  }
+
+  if (dentry->inodeNumber) _hits++;
+  else _negativeHits++;
+
+  moveToFront(dentry);
+  inodeNumber = dentry->inodeNumber;
+
+  return true;
+}
+
+void DentryCache::add(uint32_t parent, const char *name, uint32_t length, uint32_t inodeNumber) {
+  if (length > DIRECTORY_ENTRY_NAME_LENGTH) return;
+
+  uint32_t hash = hashOf(parent, name, length);
+  Dentry *dentry = find(parent, name, length, hash);
+
+  if (!dentry) {
+    dentry = _lruTail;
+
+    if (dentry->used) {
+      unhash(dentry);
+      _evictions++;
+    }
+
+    dentry->parent = parent;
+    dentry->hash = hash;
+    dentry->nameLength = length;
+    memcpy(dentry->name, (void *)name, length);
+    dentry->used = true;
+
+    Dentry **bucket = &_buckets[hash & (DENTRY_CACHE_BUCKETS - 1)];
+    dentry->hashNext = *bucket;
+    *bucket = dentry;
+  }
+
+  dentry->inodeNumber = inodeNumber;
+  moveToFront(dentry);
+}
+
+void DentryCache::invalidate(uint32_t parent, const char *name, uint32_t length) {
+  Dentry *dentry = find(parent, name, length, hashOf(parent, name, length));
+  if (!dentry) return;
+
+  unhash(dentry);
+  dentry->used = false;
+  moveToBack(dentry);
+}
+
+Dentry* DentryCache::find(uint32_t parent, const char *name, uint32_t length, uint32_t hash) {
+  for (Dentry *dentry = _buckets[hash & (DENTRY_CACHE_BUCKETS - 1)]; dentry; dentry = dentry->hashNext) {
+    if (dentry->hash != hash || dentry->parent != parent || dentry->nameLength != length) continue;
+
+    uint32_t i = 0;
+    while (i < length && dentry->name[i] == name[i]) i++;
+    if (i == length) return dentry;
+  }
+
+  return NULL;
+}
+
+void DentryCache::unhash(Dentry *dentry) {
+  for (Dentry **link = &_buckets[dentry->hash & (DENTRY_CACHE_BUCKETS - 1)]; *link; link = &(*link)->hashNext) {
+    if (*link != dentry) continue;
+
+    *link = dentry->hashNext;
+    dentry->hashNext = NULL;
+    return;
+  }
+}
+
+void DentryCache::unlink(Dentry *dentry) {
+  if (dentry->lruPrevious) dentry->lruPrevious->lruNext = dentry->lruNext;
+  else if (_lruHead == dentry) _lruHead = dentry->lruNext;
+
+  if (dentry->lruNext) dentry->lruNext->lruPrevious = dentry->lruPrevious;
+  else if (_lruTail == dentry) _lruTail = dentry->lruPrevious;
+
+  dentry->lruPrevious = NULL;
+  dentry->lruNext = NULL;
+}
+
+void DentryCache::moveToFront(Dentry *dentry) {
+  unlink(dentry);
+
+  dentry->lruNext = _lruHead;
+  if (_lruHead) _lruHead->lruPrevious = dentry;
+  _lruHead = dentry;
+  if (!_lruTail) _lruTail = dentry;
+}
+
+void DentryCache::moveToBack(Dentry *dentry) {
+  unlink(dentry);
+
+  dentry->lruPrevious = _lruTail;
+  if (_lruTail) _lruTail->lruNext = dentry;
+  _lruTail = dentry;
+  if (!_lruHead) _lruHead = dentry;
+}
+
+void DentryCache::dump() {
+  uint32_t used = 0;
+  uint32_t negative = 0;
+
+  for (uint32_t i = 0; i < DENTRY_CACHE_ENTRIES; i++) {
+    if (!_entries[i].used) continue;
+
+    used++;
+    if (!_entries[i].inodeNumber) negative++;
+  }
+
+  kprintf("\n=== Dentry cache ===");
+  kprintf("\nentries: %d, used: %d, negative: %d", DENTRY_CACHE_ENTRIES, used, negative);
+  kprintf("\nhits: %d, negative hits: %d, misses: %d, evictions: %d\n", _hits, _negativeHits, _misses, _evictions);
+}
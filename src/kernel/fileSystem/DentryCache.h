@@ -0,0 +1,73 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <kernel/fileSystem/fs.h>
+
+#define DENTRY_CACHE_ENTRIES 128
+#define DENTRY_CACHE_BUCKETS 64 // Must be a power of 2
+
+/*
+ * Result of looking up a name in a directory
+ * A negative entry (inode number 0, the invalid inode) records that the name doesn't exist
+ */
+struct Dentry {
+  uint32_t parent; // Inode number of the directory
+  uint32_t inodeNumber; // 0 for a negative entry
+  uint32_t hash;
+  uint8_t nameLength;
+  char name[DIRECTORY_ENTRY_NAME_LENGTH];
+  bool used;
+
+  Dentry *hashNext; // Next entry in the same hash bucket
+  Dentry *lruPrevious; // Least recently used list, the head is the most recently used entry
+  Dentry *lruNext;
+};
+
+/*
+ * Cache of directory lookups keyed by (parent inode, name), so that walking a path doesn't scan directories
+ * The least recently used entry is reused when the cache is full
+ */
+class DentryCache {
+  public:
+    DentryCache();
+    static DentryCache& instance();
+
+    /*
+     * Look up 'name' ('length' bytes, not null terminated) in the given directory
+     * Returns false if it's not cached, otherwise 'inodeNumber' is set (0 if the name doesn't exist)
+     */
+    bool lookup(uint32_t parent, const char *name, uint32_t length, uint32_t& inodeNumber);
+
+    /*
+     * Record the result of a directory scan, 'inodeNumber' is 0 if the name doesn't exist
+     */
+    void add(uint32_t parent, const char *name, uint32_t length, uint32_t inodeNumber);
+
+    /*
+     * Forget the given name, to be called when a directory entry is added or removed
+     */
+    void invalidate(uint32_t parent, const char *name, uint32_t length);
+
+    /*
+     * Print the hit, miss and eviction counters
+     */
+    void dump();
+
+  private:
+    Dentry* find(uint32_t parent, const char *name, uint32_t length, uint32_t hash);
+
+    void unhash(Dentry *dentry);
+    void moveToFront(Dentry *dentry);
+    void moveToBack(Dentry *dentry);
+    void unlink(Dentry *dentry);
+
+    Dentry _entries[DENTRY_CACHE_ENTRIES];
+    Dentry *_buckets[DENTRY_CACHE_BUCKETS];
+    Dentry *_lruHead { NULL };
+    Dentry *_lruTail { NULL };
+
+    uint32_t _hits { 0 };
+    uint32_t _negativeHits { 0 };
+    uint32_t _misses { 0 };
+    uint32_t _evictions { 0 };
+};
@@ -1,6 +1,8 @@
 #include <kernel/filesystem/File.h>
 #include <kernel/filesystem/FileDescription.h>
 
+#define FILE_TRANSFER_BUFFER_SIZE 512
+
 FileDescription* File::open() {
   return FileDescription::create(*this);
 }
@@ -8,3 +10,71 @@ FileDescription* File::open() {
 void File::close() {
 
 }
+
+size_t File::sendTo(FileDescription& source, FileDescription& destination, size_t size) {
+  uint8_t buffer[FILE_TRANSFER_BUFFER_SIZE];
+  size_t transferred = 0;
+
+  while (transferred < size) {
+    size_t bytes = size - transferred < sizeof(buffer) ? size - transferred : sizeof(buffer);
+
+    size_t bytesRead = source.read(buffer, bytes);
+    if (!bytesRead) break;
+
+    size_t bytesWritten = destination.write(buffer, bytesRead);
+    transferred += bytesWritten;
+
+    // Give back what the destination didn't take, so it's read again by the next transfer
+    if (bytesWritten < bytesRead) {
+      source.seek(source.offset() - (bytesRead - bytesWritten));
+      break;
+    }
+
+    if (bytesRead < bytes) break;
+  }
+
+  return transferred;
+}
+
+size_t File::pread(FileDescription&, uint8_t*, size_t, uint32_t) {
+  return 0;
+}
+
+size_t File::pwrite(FileDescription&, const uint8_t*, size_t, uint32_t) {
+  return 0;
+}
+
+size_t File::readv(FileDescription& description, const IOVector *vectors, uint32_t count) {
+  uint32_t offset = description.offset();
+  size_t transferred = 0;
+
+  // read() works at the offset of the description, move it past each buffer and put it back at the end
+  for (uint32_t i = 0; i < count; i++) {
+    size_t bytes = read(description, vectors[i].base, vectors[i].length);
+
+    transferred += bytes;
+    description.seek(offset + transferred);
+
+    if (bytes < vectors[i].length) break;
+  }
+
+  description.seek(offset);
+  return transferred;
+}
+
+size_t File::writev(FileDescription& description, const IOVector *vectors, uint32_t count) {
+  uint32_t offset = description.offset();
+  size_t transferred = 0;
+
+  for (uint32_t i = 0; i < count; i++) {
+    size_t bytes = write(description, vectors[i].base, vectors[i].length);
+
+    transferred += bytes;
+    description.seek(offset + transferred);
+
+    if (bytes < vectors[i].length) break;
+  }
+
+  description.seek(offset);
+  return transferred;
+}
@@ -1,6 +1,8 @@
 #pragma once
 #include <stddef.h>
 #include <stdint.h>
+#include <ioVector.h>
+#include <kernel/utils/WaitQueue.h>
 
 class FileDescription;
 
@@ -16,12 +18,42 @@ class File {
     virtual size_t read(FileDescription&, uint8_t*, size_t) = 0;
     virtual size_t write(FileDescription&, const uint8_t*, size_t) = 0;
 
+    /*
+     * Read or write at the given offset, without using or moving the offset of the description
+     * Files without a position (the TTY) can't be accessed at an offset, the default transfers nothing
+     */
+    virtual size_t pread(FileDescription&, uint8_t*, size_t, uint32_t offset);
+    virtual size_t pwrite(FileDescription&, const uint8_t*, size_t, uint32_t offset);
+
+    /*
+     * Read or write the given buffers in order, as a single transfer starting at the offset of the description
+     * The default calls read or write for each buffer and stops at the first short one
+     * Returns the total number of bytes transferred, the offset is moved by FileDescription like for read and write
+     */
+    virtual size_t readv(FileDescription&, const IOVector*, uint32_t count);
+    virtual size_t writev(FileDescription&, const IOVector*, uint32_t count);
+
+    /*
+     * Move up to 'size' bytes from 'source' (a description of this file) to 'destination', in the kernel
+     * The default goes through a small kernel buffer, files with cached data hand their pages to the destination
+     * Both offsets are moved past the transferred bytes, returns the number of bytes transferred
+     */
+    virtual size_t sendTo(FileDescription& source, FileDescription& destination, size_t size);
+
+    /*
+     * Woken up when the file may have become readable or writable, see canRead and canWrite
+     */
+    WaitQueue& waitQueue() { return _waitQueue; }
+
     virtual bool isInode() const { return false; }
     virtual bool isDevice() const { return false; }
     virtual bool isTTY() const { return false; }
     virtual bool isMasterPty() const { return false; }
     virtual bool isCharacterDevice() const { return false; }
+    virtual bool isBlockDevice() const { return false; }
 
   protected:
     File() {};
+
+    WaitQueue _waitQueue;
 };
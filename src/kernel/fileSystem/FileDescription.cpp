@@ -1,8 +1,84 @@
 #include <kernel/filesystem/FileDescription.h>
 #include <kernel/filesystem/File.h>
+#include <x86/x86.h>
 
 FileDescription* FileDescription::create(File& file) {
   return new FileDescription(file);
 }
 
 FileDescription::FileDescription(File& file) : _file(file) {};
+
+int FileDescription::close() {
+  if (--_references) return 0;
+
+  _file.close();
+  delete this;
+
+  return 0;
+}
+
+bool FileDescription::canRead() const {
+  return _file.canRead(const_cast<FileDescription&>(*this));
+}
+
+bool FileDescription::canWrite() const {
+  return _file.canWrite(const_cast<FileDescription&>(*this));
+}
+
+/*
+ * The wake up count is read before checking the file, so a wake up in between ends the wait right away
+ */
+void FileDescription::waitUntilReadable() {
+  uint32_t flags = disableInterrupts();
+
+  for (;;) {
+    uint32_t wakeUps = _file.waitQueue().wakeUps();
+    if (canRead()) break;
+
+    _file.waitQueue().wait(wakeUps);
+  }
+
+  restoreInterrupts(flags);
+}
+
+size_t FileDescription::read(uint8_t *buffer, size_t size) {
+  if (!_nonBlocking) waitUntilReadable();
+
+  size_t bytes = _file.read(*this, buffer, size);
+
+  _currentOffset += bytes;
+  return bytes;
+}
+
+size_t FileDescription::write(const uint8_t *buffer, size_t size) {
+  size_t bytes = _file.write(*this, buffer, size);
+
+  _currentOffset += bytes;
+  return bytes;
+}
+
+size_t FileDescription::pread(uint8_t *buffer, size_t size, uint32_t offset) {
+  return _file.pread(*this, buffer, size, offset);
+}
+
+size_t FileDescription::pwrite(const uint8_t *buffer, size_t size, uint32_t offset) {
+  return _file.pwrite(*this, buffer, size, offset);
+}
+
+size_t FileDescription::readv(const IOVector *vectors, uint32_t count) {
+  size_t bytes = _file.readv(*this, vectors, count);
+
+  _currentOffset += bytes;
+  return bytes;
+}
+
+size_t FileDescription::writev(const IOVector *vectors, uint32_t count) {
+  size_t bytes = _file.writev(*this, vectors, count);
+
+  _currentOffset += bytes;
+  return bytes;
+}
+
+size_t FileDescription::sendFile(FileDescription& destination, size_t size) {
+  return _file.sendTo(*this, destination, size);
+}
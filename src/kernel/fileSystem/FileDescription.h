@@ -1,4 +1,5 @@
 #include <kernel/filesystem/File.h>
+#include <kernel/filesystem/ReadAheadWindow.h>
 #include <stddef.h>
 
 /*
@@ -6,21 +7,73 @@
  */
 class FileDescription {
   public:
+    /*
+     * The description starts with a single reference, owned by the caller
+     */
     static FileDescription* create(File&);
 
+    void reference() { _references++; }
+
+    /*
+     * Drop a reference, the file is closed and the description freed with the last one
+     */
     int close();
     
     // TODO: use ssize_t instead
+    /*
+     * Read or write at the current offset, which is moved past the transferred bytes
+     */
     size_t read(uint8_t*, size_t);
     size_t write(const uint8_t*, size_t);
 
+    /*
+     * Read or write at the given offset, the current offset is left untouched
+     * Several users can share the description for random accesses without seeking
+     */
+    size_t pread(uint8_t*, size_t, uint32_t offset);
+    size_t pwrite(const uint8_t*, size_t, uint32_t offset);
+
+    /*
+     * Vectored read or write at the current offset, see File::readv
+     */
+    size_t readv(const IOVector*, uint32_t count);
+    size_t writev(const IOVector*, uint32_t count);
+
+    /*
+     * Move up to 'size' bytes from the current offset to 'destination' without going through a caller buffer
+     * Returns the number of bytes transferred, see File::sendTo
+     */
+    size_t sendFile(FileDescription& destination, size_t size);
+
+    uint32_t offset() const { return _currentOffset; }
+    void seek(uint32_t offset) { _currentOffset = offset; }
+
     bool canRead() const;
     bool canWrite() const;
 
+    File& file() { return _file; }
+
+    /*
+     * Reads wait for the file to be readable unless the description is non-blocking (FCNTL_NON_BLOCKING),
+     * non-blocking reads return 0 right away when there is nothing to read
+     */
+    bool isNonBlocking() const { return _nonBlocking; }
+    void setNonBlocking(bool nonBlocking) { _nonBlocking = nonBlocking; }
+
+    /*
+     * Read-ahead state of this open file, used by file systems to detect sequential reads
+     */
+    ReadAheadWindow& readAheadWindow() { return _readAheadWindow; }
+
 
   private: 
      explicit FileDescription(File&);
 
+     void waitUntilReadable();
+
      File& _file;
-     int _currentOffset { 0 };
+     uint32_t _currentOffset { 0 };
+     bool _nonBlocking { false };
+     uint32_t _references { 1 }; // File descriptors (and kernel users) holding the description
+     ReadAheadWindow _readAheadWindow { };
 };
@@ -0,0 +1,63 @@
+#include <string.h>
+#include <kernel/fileSystem/FileDescriptorTable.h>
+#include <kernel/fileSystem/FileDescription.h>
+
+static FileDescriptorTable *_current;
+
+FileDescriptorTable::FileDescriptorTable() {
+  _current = this;
+
+  memset(_descriptions, 0x0, sizeof(_descriptions));
+  memset(_used, 0x0, sizeof(_used));
+}
+
+FileDescriptorTable& FileDescriptorTable::current() {
+  return *_current;
+}
+
+int32_t FileDescriptorTable::allocate(FileDescription& description) {
+  int32_t fd = lowestFree();
+  if (fd < 0) return -1;
+
+  _descriptions[fd] = &description;
+  _used[fd / 32] |= 1 << (fd % 32);
+
+  return fd;
+}
+
+FileDescription* FileDescriptorTable::get(int32_t fd) const {
+  if (fd < 0 || fd >= MAX_FILE_DESCRIPTORS) return NULL;
+
+  return _descriptions[fd];
+}
+
+int32_t FileDescriptorTable::dup(int32_t fd) {
+  FileDescription *description = get(fd);
+  if (!description) return -1;
+
+  int32_t newFd = allocate(*description);
+  if (newFd >= 0) description->reference();
+
+  return newFd;
+}
+
+bool FileDescriptorTable::close(int32_t fd) {
+  FileDescription *description = get(fd);
+  if (!description) return false;
+
+  _descriptions[fd] = NULL;
+  _used[fd / 32] &= ~(1 << (fd % 32));
+
+  description->close();
+  return true;
+}
+
+/*
+ * The first word with a clear bit holds the lowest free slot, at its lowest clear bit
+ */
+int32_t FileDescriptorTable::lowestFree() const {
+  for (uint32_t word = 0; word < FILE_DESCRIPTOR_WORDS; word++)
+    if (~_used[word]) return word * 32 + __builtin_ctz(~_used[word]);
+
+  return -1;
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+class FileDescription;
+
+#define MAX_FILE_DESCRIPTORS 64 // Must be a multiple of 32
+#define FILE_DESCRIPTOR_WORDS (MAX_FILE_DESCRIPTORS / 32)
+
+/*
+ * Open files of a process, file descriptors are indexes into the table
+ * New descriptors always get the lowest free slot, found with a bitmap of the slots in use
+ * Several slots (dup) and tables may hold the same description, it's reference counted
+ */
+class FileDescriptorTable {
+  public:
+    FileDescriptorTable();
+
+    /*
+     * Table of the running process, the kernel is the only one until there are processes
+     */
+    static FileDescriptorTable& current();
+
+    /*
+     * Put the description in the lowest free slot, the table takes over the reference of the caller
+     * Returns the file descriptor, -1 if the table is full (the reference stays with the caller)
+     */
+    int32_t allocate(FileDescription& description);
+
+    /*
+     * Description open at the given file descriptor, NULL if it's not open
+     */
+    FileDescription* get(int32_t fd) const;
+
+    /*
+     * Open the description of 'fd' at the lowest free slot too
+     * Returns the new file descriptor, -1 if 'fd' isn't open or the table is full
+     */
+    int32_t dup(int32_t fd);
+
+    /*
+     * Free the slot, the description is closed when its last reference is dropped
+     */
+    bool close(int32_t fd);
+
+  private:
+    int32_t lowestFree() const;
+
+    FileDescription *_descriptions[MAX_FILE_DESCRIPTORS];
+    uint32_t _used[FILE_DESCRIPTOR_WORDS]; // Bit set for every slot in use
+};
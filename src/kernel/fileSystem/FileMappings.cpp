@@ -0,0 +1,115 @@
+#include <string.h>
+#include <memLayout.h>
+#include <kernel/fileSystem/FileMappings.h>
+#include <kernel/fileSystem/Inode.h>
+#include <kernel/fileSystem/InodeCache.h>
+#include <kernel/fileSystem/PageCache.h>
+
+static FileMappings *_instance;
+
+FileMappings::FileMappings() {
+  _instance = this;
+
+  memset(_mappings, 0x0, sizeof(_mappings));
+}
+
+FileMappings& FileMappings::instance() {
+  return *_instance;
+}
+
+VirtualAddress FileMappings::map(Inode& inode, uint32_t offset, uint32_t size) {
+  if (!size || offset % PAGE_SIZE) return 0;
+
+  FileMapping *mapping = NULL;
+  for (uint32_t i = 0; i < MAX_FILE_MAPPINGS && !mapping; i++)
+    if (!_mappings[i].used) mapping = &_mappings[i];
+
+  if (!mapping) return 0;
+
+  uint32_t pages = (size + PAGE_SIZE - 1) / PAGE_SIZE;
+  VirtualAddress start = findFreeRange(pages);
+  if (!start) return 0;
+
+  mapping->frames = new Page*[pages];
+  memset(mapping->frames, 0x0, pages * sizeof(Page *));
+
+  mapping->start = start;
+  mapping->pages = pages;
+  mapping->inode = &inode;
+  mapping->offset = offset;
+  mapping->used = true;
+
+  return start;
+}
+
+bool FileMappings::unmap(VirtualAddress address) {
+  FileMapping *mapping = find(address);
+  if (!mapping || mapping->start != address) return false;
+
+  for (uint32_t page = 0; page < mapping->pages; page++) {
+    if (!mapping->frames[page]) continue;
+
+    unmapPage(mapping->start + page * PAGE_SIZE);
+    PageCache::instance().release(mapping->frames[page]);
+  }
+
+  delete[] mapping->frames;
+  InodeCache::instance().release(mapping->inode);
+  memset(mapping, 0x0, sizeof(FileMapping));
+
+  return true;
+}
+
+/*
+ * The cached page past the end of the file is filled with zeros, so the mapping reads zeros there
+ * Writes to the file are copied into the cached page, so the mapping sees them
+ */
+bool FileMappings::handleFault(VirtualAddress address, bool write) {
+  FileMapping *mapping = find(address);
+  if (!mapping || write) return false;
+
+  uint32_t page = (address - mapping->start) / PAGE_SIZE;
+  if (mapping->frames[page]) return false;
+
+  Page *cached = PageCache::instance().get(*mapping->inode, mapping->offset / PAGE_SIZE + page);
+  if (!cached) return false;
+
+  mapping->frames[page] = cached;
+  mapPageWithAttributes(mapping->start + page * PAGE_SIZE, physicalAddressOf(cached->data), PTE_USER);
+
+  return true;
+}
+
+FileMapping* FileMappings::find(VirtualAddress address) {
+  for (uint32_t i = 0; i < MAX_FILE_MAPPINGS; i++) {
+    FileMapping *mapping = &_mappings[i];
+
+    if (mapping->used && address >= mapping->start && address < mapping->start + mapping->pages * PAGE_SIZE) return mapping;
+  }
+
+  return NULL;
+}
+
+VirtualAddress FileMappings::findFreeRange(uint32_t pages) {
+  VirtualAddress start = FILE_MAPPING_BASE;
+  bool moved = true;
+
+  // Move past every mapping overlapping the candidate range until none does
+  while (moved) {
+    moved = false;
+
+    for (uint32_t i = 0; i < MAX_FILE_MAPPINGS; i++) {
+      FileMapping *mapping = &_mappings[i];
+      if (!mapping->used) continue;
+
+      if (start < mapping->start + mapping->pages * PAGE_SIZE && mapping->start < start + pages * PAGE_SIZE) {
+        start = mapping->start + mapping->pages * PAGE_SIZE;
+        moved = true;
+      }
+    }
+  }
+
+  if (pages > FILE_MAPPING_SIZE / PAGE_SIZE || start - FILE_MAPPING_BASE > FILE_MAPPING_SIZE - pages * PAGE_SIZE) return 0;
+
+  return start;
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <virtualMem.h>
+
+class Inode;
+struct Page;
+
+#define MAX_FILE_MAPPINGS 16
+
+/*
+ * File mapped into the file mapping window, read only
+ * Pages are mapped on the first access, to the frame of the page cache itself (no copy),
+ * the page stays referenced in the page cache while it's mapped
+ */
+struct FileMapping {
+  VirtualAddress start;
+  uint32_t pages;
+  Inode *inode; // Referenced while mapped
+  uint32_t offset; // File offset of the first page, page aligned
+  Page **frames; // Cached page mapped at each page of the mapping, NULL until it's accessed
+  bool used;
+};
+
+/*
+ * Memory mapped files, see FileMapping
+ */
+class FileMappings {
+  public:
+    FileMappings();
+    static FileMappings& instance();
+
+    /*
+     * Map 'size' bytes of the file starting at 'offset' (page aligned), the mapping takes the given inode reference
+     * Returns the address of the mapping, 0 if the window or the mapping table is full
+     */
+    VirtualAddress map(Inode& inode, uint32_t offset, uint32_t size);
+
+    /*
+     * Remove the mapping starting at the given address, releasing its pages and its inode
+     */
+    bool unmap(VirtualAddress address);
+
+    /*
+     * Called on a page fault, map the page holding the given address if it belongs to a mapping
+     * Returns false if it doesn't, or if the access can't be allowed (a write, or a page past the end of the file)
+     */
+    bool handleFault(VirtualAddress address, bool write);
+
+  private:
+    FileMapping* find(VirtualAddress address);
+
+    /*
+     * Lowest address of the window where 'pages' pages don't overlap any mapping, 0 if there is none
+     */
+    VirtualAddress findFreeRange(uint32_t pages);
+
+    FileMapping _mappings[MAX_FILE_MAPPINGS];
+};
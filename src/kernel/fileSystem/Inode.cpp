@@ -0,0 +1,90 @@
+#include <kernel/fileSystem/Inode.h>
+#include <kernel/fileSystem/FileDescription.h>
+#include <kernel/fileSystem/PageCache.h>
+#include <kernel/fileSystem/InodeCache.h>
+#include <kernel/fileSystem/VirtualFileSystem.h>
+
+FileDescription* Inode::open() {
+  _references++;
+
+  return FileDescription::create(*this);
+}
+
+void Inode::close() {
+  InodeCache::instance().release(this);
+}
+
+size_t Inode::read(FileDescription& description, uint8_t *buffer, size_t size) {
+  return PageCache::instance().read(*this, description.offset(), buffer, size, &description.readAheadWindow());
+}
+
+size_t Inode::write(FileDescription& description, const uint8_t *buffer, size_t size) {
+  return pwrite(description, buffer, size, description.offset());
+}
+
+size_t Inode::pread(FileDescription&, uint8_t *buffer, size_t size, uint32_t offset) {
+  return PageCache::instance().read(*this, offset, buffer, size, NULL);
+}
+
+size_t Inode::pwrite(FileDescription&, const uint8_t *buffer, size_t size, uint32_t offset) {
+  uint32_t bytesWritten = VirtualFileSystem::instance().write(*this, offset, buffer, size);
+
+  PageCache::instance().update(*this, offset, buffer, bytesWritten);
+
+  return bytesWritten;
+}
+
+size_t Inode::readv(FileDescription& description, const IOVector *vectors, uint32_t count) {
+  uint32_t offset = description.offset();
+  size_t transferred = 0;
+
+  for (uint32_t i = 0; i < count; i++) {
+    size_t bytes = PageCache::instance().read(*this, offset + transferred, vectors[i].base, vectors[i].length, &description.readAheadWindow());
+
+    transferred += bytes;
+    if (bytes < vectors[i].length) break;
+  }
+
+  return transferred;
+}
+
+size_t Inode::writev(FileDescription& description, const IOVector *vectors, uint32_t count) {
+  uint32_t offset = description.offset();
+  size_t transferred = 0;
+
+  for (uint32_t i = 0; i < count; i++) {
+    size_t bytes = pwrite(description, vectors[i].base, vectors[i].length, offset + transferred);
+
+    transferred += bytes;
+    if (bytes < vectors[i].length) break;
+  }
+
+  return transferred;
+}
+
+size_t Inode::sendTo(FileDescription& source, FileDescription& destination, size_t size) {
+  size_t transferred = 0;
+
+  while (transferred < size && source.offset() < this->size()) {
+    uint32_t offset = source.offset();
+    uint32_t offsetInPage = offset % PAGE_SIZE;
+
+    size_t bytes = PAGE_SIZE - offsetInPage;
+    if (bytes > size - transferred) bytes = size - transferred;
+    if (bytes > this->size() - offset) bytes = this->size() - offset;
+
+    // The page can't be cached, move the rest through a kernel buffer
+    Page *page = PageCache::instance().get(*this, offset / PAGE_SIZE, &source.readAheadWindow());
+    if (!page) return transferred + File::sendTo(source, destination, size - transferred);
+
+    size_t bytesWritten = destination.write(page->data + offsetInPage, bytes);
+    PageCache::instance().release(page);
+
+    source.seek(offset + bytesWritten);
+    transferred += bytesWritten;
+
+    if (bytesWritten < bytes) break;
+  }
+
+  return transferred;
+}
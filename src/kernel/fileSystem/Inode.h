@@ -1,17 +1,85 @@
 #pragma once
 #include <stdint.h>
+#include <stddef.h>
+#include <kernel/fileSystem/File.h>
+#include <kernel/fileSystem/fs.h>
 
+/*
+ * In-memory copy of an on-disk inode, owned by the inode cache
+ * Get it with InodeCache::get() and give it back with InodeCache::release()
+ */
+class Inode : public File {
+  public:
+    Inode() : File() {};
 
-class Inode {
-public:
-  Inode();
-  Inode(Inode &&) = default;
-  Inode(const Inode &) = default;
-  Inode &operator=(Inode &&) = default;
-  Inode &operator=(const Inode &) = default;
-  ~Inode();
+    uint32_t number() const { return _number; }
+    uint8_t type() const { return _inode.type; }
+    uint32_t size() const { return _inode.sizeInBytes; }
+    bool isDirectory() const { return _inode.type == FILETYPE_DIRECTORY; }
 
-private:
-  
-};
+    /*
+     * On-disk fields, call markDirty() after modifying them so they are written back
+     */
+    const struct inode& data() const { return _inode; }
+    struct inode& data() { return _inode; }
+
+    void markDirty() { _dirty = true; }
+
+    /*
+     * An open description holds a reference on the inode, given back when the description is closed
+     */
+    virtual FileDescription* open() override;
+    virtual void close() override;
+
+    virtual bool canRead(FileDescription&) const override { return true; }
+    virtual bool canWrite(FileDescription&) const override { return !isDirectory(); }
+
+    /*
+     * Read or write the file data at the current offset of the file description
+     */
+    virtual size_t read(FileDescription&, uint8_t*, size_t) override;
+    virtual size_t write(FileDescription&, const uint8_t*, size_t) override;
+
+    /*
+     * Positional accesses don't use the read-ahead window of the description, they aren't part of its sequential reads
+     */
+    virtual size_t pread(FileDescription&, uint8_t*, size_t, uint32_t offset) override;
+    virtual size_t pwrite(FileDescription&, const uint8_t*, size_t, uint32_t offset) override;
+
+    /*
+     * Read the buffers through the page cache, or write them through the file system, one after the other
+     */
+    virtual size_t readv(FileDescription&, const IOVector*, uint32_t count) override;
+    virtual size_t writev(FileDescription&, const IOVector*, uint32_t count) override;
+
+    /*
+     * Write the cached pages of the file straight to the destination, without copying them first
+     */
+    virtual size_t sendTo(FileDescription& source, FileDescription& destination, size_t size) override;
 
+    virtual bool isInode() const override final { return true; }
+
+  private:
+    friend class InodeCache;
+    friend class PageCache;
+    friend class VirtualFileSystem;
+
+    struct inode _inode;
+
+    uint16_t _references { 0 };
+    bool _valid { false }; // '_inode' holds the inode '_number'
+    bool _dirty { false }; // Modified since it was read, must be written back before being evicted
+    uint32_t _number { 0 };
+
+    // Blocks pre-allocated for the file to grow into, given back when the inode is evicted
+    uint32_t _reservedBlock { 0 };
+    uint32_t _reservedBlocks { 0 };
+
+    // Radix tree of the cached pages of the file, see PageCache
+    struct PageTreeNode *_pageTree { NULL };
+    uint8_t _pageTreeHeight { 0 };
+
+    Inode *_hashNext { NULL };
+    Inode *_lruPrevious { NULL }; // Least recently used list, the head is the most recently used inode
+    Inode *_lruNext { NULL };
+};
@@ -0,0 +1,162 @@
+#include <string.h>
+#include <kernel/fileSystem/InodeCache.h>
+#include <kernel/fileSystem/VirtualFileSystem.h>
+#include <kernel/fileSystem/BlockAllocator.h>
+#include <kernel/fileSystem/PageCache.h>
+#include <kernel/utils/kprintf.h>
+
+static InodeCache *_instance;
+
+static inline uint32_t bucketOf(uint32_t number) {
+  return number & (INODE_CACHE_BUCKETS - 1);
+}
+
+InodeCache::InodeCache() {
+  _instance = this;
+
+  memset(_buckets, 0x0, sizeof(_buckets));
+
+  for (uint32_t i = 0; i < INODE_CACHE_INODES; i++) moveToBack(&_inodes[i]);
+}
+
+InodeCache& InodeCache::instance() {
+  return *_instance;
+}
+
+Inode* InodeCache::get(uint32_t number) {
+  Inode *inode = lookup(number);
+
+  if (inode) {
+    _hits++;
+    inode->_references++;
+    moveToFront(inode);
+    return inode;
+  }
+
+  _misses++;
+
+  inode = reuse();
+  if (!inode) return NULL;
+
+  if (!VirtualFileSystem::instance().readInode(number, inode->_inode)) {
+    moveToBack(inode);
+    return NULL;
+  }
+
+  inode->_number = number;
+  inode->_valid = true;
+  inode->_references = 1;
+  hash(inode);
+  moveToFront(inode);
+
+  return inode;
+}
+
+void InodeCache::release(Inode *inode) {
+  if (inode && inode->_references) inode->_references--;
+}
+
+void InodeCache::sync() {
+  for (uint32_t i = 0; i < INODE_CACHE_INODES; i++)
+    if (_inodes[i]._valid && _inodes[i]._dirty) writeBack(&_inodes[i]);
+}
+
+bool InodeCache::writeBack(Inode *inode) {
+  if (!VirtualFileSystem::instance().writeInode(inode->_number, inode->_inode)) return false;
+
+  inode->_dirty = false;
+  return true;
+}
+
+Inode* InodeCache::lookup(uint32_t number) {
+  for (Inode *inode = _buckets[bucketOf(number)]; inode; inode = inode->_hashNext)
+    if (inode->_number == number) return inode;
+
+  return NULL;
+}
+
+Inode* InodeCache::reuse() {
+  Inode *inode = _lruTail;
+
+  // An inode that can't be written back is kept, so the modification isn't lost
+  while (inode && (inode->_references || (inode->_dirty && !writeBack(inode)))) inode = inode->_lruPrevious;
+  if (!inode) return NULL;
+
+  if (inode->_valid) {
+    PageCache::instance().evict(*inode);
+    unhash(inode);
+    _evictions++;
+  }
+
+  if (inode->_reservedBlocks) {
+    BlockAllocator::instance().free(inode->_reservedBlock, inode->_reservedBlocks);
+    inode->_reservedBlocks = 0;
+  }
+
+  inode->_valid = false;
+  inode->_dirty = false;
+
+  return inode;
+}
+
+void InodeCache::hash(Inode *inode) {
+  Inode **bucket = &_buckets[bucketOf(inode->_number)];
+
+  inode->_hashNext = *bucket;
+  *bucket = inode;
+}
+
+void InodeCache::unhash(Inode *inode) {
+  for (Inode **link = &_buckets[bucketOf(inode->_number)]; *link; link = &(*link)->_hashNext) {
+    if (*link != inode) continue;
+
+    *link = inode->_hashNext;
+    inode->_hashNext = NULL;
+    return;
+  }
+}
+
+void InodeCache::unlink(Inode *inode) {
+  if (inode->_lruPrevious) inode->_lruPrevious->_lruNext = inode->_lruNext;
+  else if (_lruHead == inode) _lruHead = inode->_lruNext;
+
+  if (inode->_lruNext) inode->_lruNext->_lruPrevious = inode->_lruPrevious;
+  else if (_lruTail == inode) _lruTail = inode->_lruPrevious;
+
+  inode->_lruPrevious = NULL;
+  inode->_lruNext = NULL;
+}
+
+void InodeCache::moveToFront(Inode *inode) {
+  unlink(inode);
+
+  inode->_lruNext = _lruHead;
+  if (_lruHead) _lruHead->_lruPrevious = inode;
+  _lruHead = inode;
+  if (!_lruTail) _lruTail = inode;
+}
+
+void InodeCache::moveToBack(Inode *inode) {
+  unlink(inode);
+
+  inode->_lruPrevious = _lruTail;
+  if (_lruTail) _lruTail->_lruNext = inode;
+  _lruTail = inode;
+  if (!_lruHead) _lruHead = inode;
+}
+
+void InodeCache::dump() {
+  uint32_t cached = 0;
+  uint32_t referenced = 0;
+  uint32_t dirty = 0;
+
+  for (uint32_t i = 0; i < INODE_CACHE_INODES; i++) {
+    if (_inodes[i]._valid) cached++;
+    if (_inodes[i]._references) referenced++;
+    if (_inodes[i]._dirty) dirty++;
+  }
+
+  kprintf("\n=== Inode cache ===");
+  kprintf("\ninodes: %d, cached: %d, referenced: %d, dirty: %d", INODE_CACHE_INODES, cached, referenced, dirty);
+  kprintf("\nhits: %d, misses: %d, evictions: %d\n", _hits, _misses, _evictions);
+}
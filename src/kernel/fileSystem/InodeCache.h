@@ -0,0 +1,68 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <kernel/fileSystem/Inode.h>
+
+#define INODE_CACHE_INODES 64
+#define INODE_CACHE_BUCKETS 32 // Must be a power of 2
+
+/*
+ * Cache of in-memory inodes keyed by inode number
+ * Lookups go through a hash table, the least recently used unreferenced inode is reused on a miss
+ * A dirty inode is copied back to the inode table (through the buffer cache) before being reused,
+ * the blocks it had pre-allocated are freed and its pages are dropped from the page cache
+ */
+class InodeCache {
+  public:
+    InodeCache();
+    static InodeCache& instance();
+
+    /*
+     * Get the given inode, reading it from the inode table if it's not cached
+     * The inode stays referenced until it's released
+     * Returns NULL if the inode doesn't exist or every inode is in use
+     */
+    Inode* get(uint32_t number);
+
+    void release(Inode *inode);
+
+    /*
+     * Copy every dirty inode back to the inode table
+     */
+    void sync();
+
+    /*
+     * Copy the inode into its block of the inode table in the buffer cache, where the periodic flush writes it
+     * Must not be called from an IRQ handler, the block may have to be read
+     */
+    bool writeBack(Inode *inode);
+
+    /*
+     * Print the hit, miss and eviction counters
+     */
+    void dump();
+
+  private:
+    Inode* lookup(uint32_t number);
+
+    /*
+     * Least recently used inode not referenced, written back if dirty, NULL if there is none
+     * The inode is unhashed and ready to hold another inode
+     */
+    Inode* reuse();
+
+    void hash(Inode *inode);
+    void unhash(Inode *inode);
+    void moveToFront(Inode *inode);
+    void moveToBack(Inode *inode);
+    void unlink(Inode *inode);
+
+    Inode _inodes[INODE_CACHE_INODES];
+    Inode *_buckets[INODE_CACHE_BUCKETS];
+    Inode *_lruHead { NULL };
+    Inode *_lruTail { NULL };
+
+    uint32_t _hits { 0 };
+    uint32_t _misses { 0 };
+    uint32_t _evictions { 0 };
+};
@@ -0,0 +1,305 @@
+#include <string.h>
+#include <kernel/fileSystem/PageCache.h>
+#include <kernel/fileSystem/Inode.h>
+#include <kernel/fileSystem/VirtualFileSystem.h>
+#include <kernel/utils/kprintf.h>
+
+static PageCache *_instance;
+
+/*
+ * Page data lives in the kernel image, so each page is a whole frame that can be mapped by itself
+ */
+static uint8_t pageData[PAGE_CACHE_PAGES][PAGE_SIZE] __attribute__ ((aligned(PAGE_SIZE)));
+
+static inline uint32_t slotOf(uint32_t index, uint32_t level) {
+  return (index >> (PAGE_TREE_SHIFT * (level - 1))) & (PAGE_TREE_SLOTS - 1);
+}
+
+/*
+ * Number of pages a tree of the given height can hold
+ */
+static inline uint32_t treeCapacity(uint32_t height) {
+  return 1 << (PAGE_TREE_SHIFT * height);
+}
+
+PageCache::PageCache() {
+  _instance = this;
+
+  memset(_pages, 0x0, sizeof(_pages));
+  memset(_nodes, 0x0, sizeof(_nodes));
+
+  for (uint32_t i = 0; i < PAGE_CACHE_PAGES; i++) {
+    _pages[i].data = pageData[i];
+    moveToBack(&_pages[i]);
+  }
+
+  for (uint32_t i = 0; i < PAGE_TREE_NODES; i++) freeNode(&_nodes[i]);
+}
+
+PageCache& PageCache::instance() {
+  return *_instance;
+}
+
+uint32_t PageCache::read(Inode& inode, uint32_t offset, uint8_t *destination, uint32_t size, ReadAheadWindow *window) {
+  uint32_t bytesRead = 0;
+
+  if (offset >= inode.size()) return 0;
+  if (size > inode.size() - offset) size = inode.size() - offset;
+
+  while (size) {
+    uint32_t offsetInPage = offset % PAGE_SIZE;
+    uint32_t bytes = PAGE_SIZE - offsetInPage < size ? PAGE_SIZE - offsetInPage : size;
+
+    Page *page = get(inode, offset / PAGE_SIZE, window);
+
+    if (page) {
+      memcpy(destination, page->data + offsetInPage, bytes);
+      release(page);
+    } else {
+      // No frame can be reclaimed for the page, read around the cache
+      uint32_t bytesReadAround = VirtualFileSystem::instance().read(inode.data(), offset, destination, bytes, window);
+
+      if (bytesReadAround < bytes) {
+        bytesRead += bytesReadAround;
+        break;
+      }
+    }
+
+    bytesRead += bytes;
+    destination += bytes;
+    offset += bytes;
+    size -= bytes;
+  }
+
+  return bytesRead;
+}
+
+void PageCache::update(Inode& inode, uint32_t offset, const uint8_t *source, uint32_t size) {
+  while (size) {
+    uint32_t offsetInPage = offset % PAGE_SIZE;
+    uint32_t bytes = PAGE_SIZE - offsetInPage < size ? PAGE_SIZE - offsetInPage : size;
+
+    Page *page = lookup(inode, offset / PAGE_SIZE);
+    if (page) memcpy(page->data + offsetInPage, (void *)source, bytes);
+
+    source += bytes;
+    offset += bytes;
+    size -= bytes;
+  }
+}
+
+Page* PageCache::get(Inode& inode, uint32_t index, ReadAheadWindow *window) {
+  Page *page = lookup(inode, index);
+
+  if (page) {
+    _hits++;
+    page->references++;
+    moveToFront(page);
+    return page;
+  }
+
+  _misses++;
+
+  if (index >= (inode.size() + PAGE_SIZE - 1) / PAGE_SIZE) return NULL;
+
+  page = reclaim();
+  if (!page) return NULL;
+
+  // Referenced while it's filled, so it isn't reclaimed again to make room for the tree nodes
+  page->references = 1;
+
+  uint32_t offset = index * PAGE_SIZE;
+  uint32_t expected = inode.size() - offset < PAGE_SIZE ? inode.size() - offset : PAGE_SIZE;
+  uint32_t bytes = VirtualFileSystem::instance().read(inode.data(), offset, page->data, expected, window);
+
+  page->inode = &inode;
+  page->index = index;
+
+  if (bytes < expected || !insert(page)) {
+    page->inode = NULL;
+    page->references = 0;
+    moveToBack(page);
+    return NULL;
+  }
+
+  memset(page->data + bytes, 0x0, PAGE_SIZE - bytes);
+  moveToFront(page);
+
+  return page;
+}
+
+void PageCache::release(Page *page) {
+  if (page && page->references) page->references--;
+}
+
+void PageCache::evict(Inode& inode) {
+  for (uint32_t i = 0; i < PAGE_CACHE_PAGES && inode._pageTree; i++) {
+    Page *page = &_pages[i];
+    if (page->inode != &inode) continue;
+
+    remove(page);
+    moveToBack(page);
+  }
+}
+
+Page* PageCache::lookup(Inode& inode, uint32_t index) {
+  if (!inode._pageTree || index >= treeCapacity(inode._pageTreeHeight)) return NULL;
+
+  void *slot = inode._pageTree;
+  for (uint32_t level = inode._pageTreeHeight; level && slot; level--)
+    slot = ((PageTreeNode *)slot)->slots[slotOf(index, level)];
+
+  return (Page *)slot;
+}
+
+bool PageCache::insert(Page *page) {
+  Inode& inode = *page->inode;
+
+  // Nodes are only freed with the pages they hold, reclaim pages until there are enough for the deepest path
+  for (Page *victim = _lruTail; victim && _freeNodeCount < PAGE_TREE_MAX_HEIGHT;) {
+    Page *previous = victim->lruPrevious;
+
+    if (victim->inode && !victim->references) {
+      remove(victim);
+      moveToBack(victim);
+      _reclaims++;
+    }
+
+    victim = previous;
+  }
+
+  if (_freeNodeCount < PAGE_TREE_MAX_HEIGHT) return false;
+
+  // Grow the tree from the top, the current tree becomes the first slot of the new root
+  while (!inode._pageTreeHeight || page->index >= treeCapacity(inode._pageTreeHeight)) {
+    if (inode._pageTree) {
+      PageTreeNode *root = allocateNode();
+      root->slots[0] = inode._pageTree;
+      root->count = 1;
+      inode._pageTree = root;
+    }
+
+    inode._pageTreeHeight++;
+  }
+
+  if (!inode._pageTree) inode._pageTree = allocateNode();
+
+  PageTreeNode *node = inode._pageTree;
+  for (uint32_t level = inode._pageTreeHeight; level > 1; level--) {
+    void **slot = &node->slots[slotOf(page->index, level)];
+
+    if (!*slot) {
+      *slot = allocateNode();
+      node->count++;
+    }
+
+    node = (PageTreeNode *)*slot;
+  }
+
+  node->slots[slotOf(page->index, 1)] = page;
+  node->count++;
+
+  return true;
+}
+
+void PageCache::remove(Page *page) {
+  Inode& inode = *page->inode;
+  PageTreeNode *path[PAGE_TREE_MAX_HEIGHT];
+
+  PageTreeNode *node = inode._pageTree;
+  for (uint32_t level = inode._pageTreeHeight; level; level--) {
+    path[level - 1] = node;
+    if (level > 1) node = (PageTreeNode *)node->slots[slotOf(page->index, level)];
+  }
+
+  // Clear the page slot, then the slot of every node left empty, from the bottom up
+  for (uint32_t level = 1; level <= inode._pageTreeHeight; level++) {
+    node = path[level - 1];
+    node->slots[slotOf(page->index, level)] = NULL;
+
+    if (--node->count) break;
+
+    freeNode(node);
+
+    if (level == inode._pageTreeHeight) {
+      inode._pageTree = NULL;
+      inode._pageTreeHeight = 0;
+    }
+  }
+
+  page->inode = NULL;
+}
+
+Page* PageCache::reclaim() {
+  Page *page = _lruTail;
+
+  while (page && page->references) page = page->lruPrevious;
+  if (!page) return NULL;
+
+  if (page->inode) {
+    remove(page);
+    _reclaims++;
+  }
+
+  return page;
+}
+
+PageTreeNode* PageCache::allocateNode() {
+  PageTreeNode *node = _freeNodes;
+  if (!node) return NULL;
+
+  _freeNodes = (PageTreeNode *)node->slots[0];
+  _freeNodeCount--;
+
+  memset(node, 0x0, sizeof(PageTreeNode));
+  return node;
+}
+
+void PageCache::freeNode(PageTreeNode *node) {
+  node->slots[0] = _freeNodes;
+  _freeNodes = node;
+  _freeNodeCount++;
+}
+
+void PageCache::unlink(Page *page) {
+  if (page->lruPrevious) page->lruPrevious->lruNext = page->lruNext;
+  else if (_lruHead == page) _lruHead = page->lruNext;
+
+  if (page->lruNext) page->lruNext->lruPrevious = page->lruPrevious;
+  else if (_lruTail == page) _lruTail = page->lruPrevious;
+
+  page->lruPrevious = NULL;
+  page->lruNext = NULL;
+}
+
+void PageCache::moveToFront(Page *page) {
+  unlink(page);
+
+  page->lruNext = _lruHead;
+  if (_lruHead) _lruHead->lruPrevious = page;
+  _lruHead = page;
+  if (!_lruTail) _lruTail = page;
+}
+
+void PageCache::moveToBack(Page *page) {
+  unlink(page);
+
+  page->lruPrevious = _lruTail;
+  if (_lruTail) _lruTail->lruNext = page;
+  _lruTail = page;
+  if (!_lruHead) _lruHead = page;
+}
+
+void PageCache::dump() {
+  uint32_t cached = 0;
+  uint32_t referenced = 0;
+
+  for (uint32_t i = 0; i < PAGE_CACHE_PAGES; i++) {
+    if (_pages[i].inode) cached++;
+    if (_pages[i].references) referenced++;
+  }
+
+  kprintf("\n=== Page cache ===");
+  kprintf("\npages: %d, cached: %d, referenced: %d, free tree nodes: %d", PAGE_CACHE_PAGES, cached, referenced, _freeNodeCount);
+  kprintf("\nhits: %d, misses: %d, reclaims: %d\n", _hits, _misses, _reclaims);
+}
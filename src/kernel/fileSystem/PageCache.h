@@ -0,0 +1,120 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <mmu.h>
+#include <kernel/fileSystem/ReadAheadWindow.h>
+
+class Inode;
+
+#define PAGE_CACHE_PAGES 256 // 1 MiB of cached file data
+#define PAGE_TREE_NODES 128
+#define PAGE_TREE_SHIFT 6
+#define PAGE_TREE_SLOTS (1 << PAGE_TREE_SHIFT)
+#define PAGE_TREE_MAX_HEIGHT 4 // 2^24 pages, more than a 32 bit file offset can reach
+
+/*
+ * Page of file data, PAGE_SIZE bytes starting at 'index' * PAGE_SIZE in the file
+ * The part past the end of the file is filled with zeros
+ */
+struct Page {
+  Inode *inode; // NULL if the page doesn't hold any file data
+  uint32_t index;
+  uint8_t *data;
+
+  uint16_t references; // Users holding the page (mappings), it's never reclaimed while referenced
+
+  Page *lruPrevious; // Least recently used list, the head is the most recently used page
+  Page *lruNext;
+};
+
+/*
+ * Node of the radix tree of an inode, keyed by page index, PAGE_TREE_SHIFT bits per level
+ * The slots of the lowest level hold pages, the others hold nodes
+ */
+struct PageTreeNode {
+  void *slots[PAGE_TREE_SLOTS];
+  uint32_t count; // Slots in use, the node is freed when it drops to 0
+};
+
+/*
+ * Cache of file data, pages are looked up in the radix tree of their inode
+ * Pages are filled through the file system (and the buffer cache) on a miss, and kept until
+ * their frame is reclaimed for another page (least recently used first) or their inode is evicted
+ *
+ * Writes go through the file system and are copied into the pages already cached, so reads and
+ * mappings always see the latest data
+ */
+class PageCache {
+  public:
+    PageCache();
+    static PageCache& instance();
+
+    /*
+     * Read up to 'size' bytes of the file data starting at 'offset', filling the missing pages
+     * The read-ahead window, if given, is used for the pages read from the file system
+     * Returns the number of bytes read
+     */
+    uint32_t read(Inode& inode, uint32_t offset, uint8_t *destination, uint32_t size, ReadAheadWindow *window);
+
+    /*
+     * Copy 'size' bytes just written to the file at 'offset' into the pages that are cached
+     */
+    void update(Inode& inode, uint32_t offset, const uint8_t *source, uint32_t size);
+
+    /*
+     * Get the given page of the file, filling it if it's not cached
+     * The page stays referenced until it's released
+     * Returns NULL if it can't be read, or no frame or tree node can be reclaimed for it
+     */
+    Page* get(Inode& inode, uint32_t index, ReadAheadWindow *window = NULL);
+
+    void release(Page *page);
+
+    /*
+     * Drop every page of the inode, called before the inode is reused for another one
+     */
+    void evict(Inode& inode);
+
+    /*
+     * Print the hit, miss and reclaim counters
+     */
+    void dump();
+
+  private:
+    Page* lookup(Inode& inode, uint32_t index);
+
+    /*
+     * Add the page to the tree of its inode, growing the tree as needed
+     * Returns false if there are no free tree nodes left
+     */
+    bool insert(Page *page);
+
+    /*
+     * Remove the page from the tree of its inode, freeing the nodes left empty
+     */
+    void remove(Page *page);
+
+    /*
+     * Least recently used page not referenced, removed from its tree, NULL if there is none
+     */
+    Page* reclaim();
+
+    PageTreeNode* allocateNode();
+    void freeNode(PageTreeNode *node);
+
+    void moveToFront(Page *page);
+    void moveToBack(Page *page);
+    void unlink(Page *page);
+
+    Page _pages[PAGE_CACHE_PAGES];
+    Page *_lruHead { NULL };
+    Page *_lruTail { NULL };
+
+    PageTreeNode _nodes[PAGE_TREE_NODES];
+    PageTreeNode *_freeNodes { NULL }; // Linked through their first slot
+    uint32_t _freeNodeCount { 0 };
+
+    uint32_t _hits { 0 };
+    uint32_t _misses { 0 };
+    uint32_t _reclaims { 0 };
+};
@@ -0,0 +1,20 @@
+#pragma once
+#include <stdint.h>
+
+#define READAHEAD_INITIAL_BLOCKS 4
+#define READAHEAD_MAX_BLOCKS 32
+
+/*
+ * Read-ahead state of an open file, in file blocks
+ *
+ * While the file is read sequentially, the blocks [start, end) are being prefetched
+ * Once the reader gets to 'start', the next window (twice as big, up to READAHEAD_MAX_BLOCKS) is prefetched,
+ * so the disk works on it while the current one is consumed
+ * A non sequential read closes the window until sequential reads start again
+ */
+struct ReadAheadWindow {
+  uint32_t nextBlock; // Block a sequential reader would read next
+  uint32_t start;
+  uint32_t end;
+  uint32_t size; // 0 when there is no window
+};
@@ -1,52 +1,663 @@
 #include "VirtualFileSystem.h"
 #include <kernel/utils/kprintf.h>
-#include <io.h>
+#include <kernel/devices/BlockDevice.h>
+#include <kernel/fileSystem/BufferCache.h>
+#include <kernel/fileSystem/DentryCache.h>
+#include <kernel/fileSystem/InodeCache.h>
+#include <kernel/fileSystem/BlockAllocator.h>
 #include <string.h>
 
+#define INODES_PER_BLOCK (BLOCK_SIZE / sizeof(struct inode))
+#define EXTENT_MAX_DEPTH 4 // Guards against a corrupted tree pointing back to itself
+
 static VirtualFileSystem *_instance;
 
+/*
+ * Copies of the pointer blocks cached by pointerBlock(), outside of the instance so it stays small
+ */
+static uint32_t pointerBlockData[POINTER_BLOCK_CACHE_SLOTS][POINTERS_PER_BLOCK];
+
 VirtualFileSystem::VirtualFileSystem() {
   _instance = this;
   this->test = 42;
 }
- 
+
 VirtualFileSystem& VirtualFileSystem::instance() {
   return *_instance;
 }
 
+void VirtualFileSystem::setDevice(BlockDevice& device) {
+  _device = &device;
+}
+
 void VirtualFileSystem::loadSuperBlock() {
-  VirtualFileSystem::readSector(_instance->tempSector, 1 * 8);
-  memcpy(&_superBlock, tempSector, sizeof(struct superBlock));
+  Buffer *buffer = BufferCache::instance().get(*_device, SUPERBLOCK_BLOCK);
+  if (!buffer) return;
+
+  memcpy(&_superBlock, buffer->data, sizeof(struct superBlock));
+  BufferCache::instance().release(buffer);
+}
+
+bool VirtualFileSystem::readInode(uint32_t number, struct inode& result) {
+  if (number >= _superBlock.totalNumberOfInodes) return false;
+
+  Buffer *buffer = BufferCache::instance().get(*_device, _superBlock.firstInodeBlock + number / INODES_PER_BLOCK);
+  if (!buffer) return false;
+
+  memcpy(&result, buffer->data + (number % INODES_PER_BLOCK) * sizeof(struct inode), sizeof(struct inode));
+  BufferCache::instance().release(buffer);
+
+  return true;
+}
+
+bool VirtualFileSystem::writeInode(uint32_t number, const struct inode& inode) {
+  if (number >= _superBlock.totalNumberOfInodes) return false;
+
+  Buffer *buffer = BufferCache::instance().get(*_device, _superBlock.firstInodeBlock + number / INODES_PER_BLOCK);
+  if (!buffer) return false;
+
+  memcpy(buffer->data + (number % INODES_PER_BLOCK) * sizeof(struct inode), (void *)&inode, sizeof(struct inode));
+  BufferCache::instance().markDirty(buffer);
+  BufferCache::instance().release(buffer);
+
+  return true;
+}
+
+uint32_t VirtualFileSystem::mapBlock(const struct inode& inode, uint32_t fileBlock, uint32_t *contiguous) {
+  if (contiguous) *contiguous = 0;
+
+  if (!(inode.flags & INODE_FLAG_EXTENTS)) return mapBlockPointers(inode, fileBlock, contiguous);
+
+  // The root isn't aligned in the packed inode, it's searched in an aligned copy
+  uint32_t root[INODE_DIRECT_BLOCKS];
+  memcpy(root, (void *)inode.extentRoot, sizeof(root));
+
+  const struct extentHeader *header = (const struct extentHeader *)root;
+  Buffer *buffer = NULL;
+  uint32_t block = 0;
+
+  for (uint32_t level = 0; level <= EXTENT_MAX_DEPTH; level++) {
+    if (header->magic != EXTENT_MAGIC || !header->entries) break;
+
+    // Last record starting at or before the file block
+    const struct extent *records = (const struct extent *)(header + 1);
+    uint32_t low = 0;
+    uint32_t high = header->entries;
+
+    while (high - low > 1) {
+      uint32_t middle = (low + high) / 2;
+
+      if (records[middle].fileBlock <= fileBlock) low = middle;
+      else high = middle;
+    }
+
+    if (records[low].fileBlock > fileBlock) break;
+
+    if (!header->depth) {
+      uint32_t offset = fileBlock - records[low].fileBlock;
+
+      if (offset < records[low].length) {
+        block = records[low].startBlock + offset;
+        if (contiguous) *contiguous = records[low].length - offset;
+      }
+      break;
+    }
+
+    Buffer *child = BufferCache::instance().get(*_device, ((const struct extentIndex *)records)[low].childBlock);
+    BufferCache::instance().release(buffer);
+
+    buffer = child;
+    if (!buffer) break;
+
+    header = (const struct extentHeader *)buffer->data;
+  }
+
+  BufferCache::instance().release(buffer);
+  return block;
+}
+
+/*
+ * The runs reported in 'contiguous' stop at the end of the pointer block
+ */
+uint32_t VirtualFileSystem::mapBlockPointers(const struct inode& inode, uint32_t fileBlock, uint32_t *contiguous) {
+  uint32_t direct[INODE_DIRECT_BLOCKS]; // Aligned copy of the direct blocks of the packed inode
+  const uint32_t *pointers;
+  uint32_t index;
+  uint32_t count;
+
+  if (fileBlock < INODE_INDIRECT_FIRST_BLOCK) {
+    memcpy(direct, (void *)inode.directDataBlocks, sizeof(direct));
+    pointers = direct;
+    index = fileBlock;
+    count = INODE_DIRECT_BLOCKS;
+  } else if (fileBlock < INODE_DOUBLE_INDIRECT_FIRST_BLOCK) {
+    pointers = pointerBlock(inode.indirectBlock);
+    index = fileBlock - INODE_INDIRECT_FIRST_BLOCK;
+    count = POINTERS_PER_BLOCK;
+  } else {
+    uint32_t offset = fileBlock - INODE_DOUBLE_INDIRECT_FIRST_BLOCK;
+    if (offset / POINTERS_PER_BLOCK >= POINTERS_PER_BLOCK) return 0;
+
+    const uint32_t *indirect = pointerBlock(inode.doubleIndirectBlock);
+    pointers = indirect ? pointerBlock(indirect[offset / POINTERS_PER_BLOCK]) : NULL;
+    index = offset % POINTERS_PER_BLOCK;
+    count = POINTERS_PER_BLOCK;
+  }
+
+  if (!pointers || !pointers[index]) return 0;
+
+  if (contiguous) {
+    uint32_t last = index + 1;
+    while (last < count && pointers[last] == pointers[last - 1] + 1) last++;
+    *contiguous = last - index;
+  }
+
+  return pointers[index];
+}
+
+/*
+ * The slots hold copies of the pointer blocks, the buffers aren't kept referenced
+ * so they're still flushed and reused like any other
+ */
+const uint32_t* VirtualFileSystem::pointerBlock(uint32_t block) {
+  if (!block) return NULL;
+
+  uint32_t slot = block % POINTER_BLOCK_CACHE_SLOTS;
+
+  if (_pointerBlocks[slot] == block) return pointerBlockData[slot];
+
+  Buffer *buffer = BufferCache::instance().get(*_device, block);
+  if (!buffer) return NULL;
+
+  memcpy(pointerBlockData[slot], buffer->data, BLOCK_SIZE);
+  BufferCache::instance().release(buffer);
+  _pointerBlocks[slot] = block;
+
+  return pointerBlockData[slot];
+}
+
+uint32_t VirtualFileSystem::read(const struct inode& inode, uint32_t offset, uint8_t *destination, uint32_t size, ReadAheadWindow *window) {
+  uint32_t bytesRead = 0;
+
+  if (offset >= inode.sizeInBytes) return 0;
+  if (size > inode.sizeInBytes - offset) size = inode.sizeInBytes - offset;
+
+  while (size) {
+    uint32_t fileBlock = offset / BLOCK_SIZE;
+    uint32_t offsetInBlock = offset % BLOCK_SIZE;
+    uint32_t bytes = BLOCK_SIZE - offsetInBlock < size ? BLOCK_SIZE - offsetInBlock : size;
+
+    if (window) readAhead(inode, *window, fileBlock);
+
+    uint32_t block = mapBlock(inode, fileBlock);
+    if (!block) break;
+
+    Buffer *buffer = BufferCache::instance().get(*_device, block);
+    if (!buffer) break;
+
+    memcpy(destination, buffer->data + offsetInBlock, bytes);
+    BufferCache::instance().release(buffer);
+
+    destination += bytes;
+    offset += bytes;
+    size -= bytes;
+    bytesRead += bytes;
+  }
+
+  return bytesRead;
+}
+
+uint32_t VirtualFileSystem::write(Inode& inode, uint32_t offset, const uint8_t *source, uint32_t size) {
+  uint32_t bytesWritten = 0;
+
+  // No holes
+  if (offset > inode.size()) return 0;
+
+  while (size) {
+    uint32_t fileBlock = offset / BLOCK_SIZE;
+    uint32_t offsetInBlock = offset % BLOCK_SIZE;
+    uint32_t bytes = BLOCK_SIZE - offsetInBlock < size ? BLOCK_SIZE - offsetInBlock : size;
+    Buffer *buffer;
+
+    uint32_t block = mapBlock(inode.data(), fileBlock);
+
+    if (block) {
+      // The block is read first even if it's entirely overwritten
+      buffer = BufferCache::instance().get(*_device, block);
+    } else {
+      block = allocateBlock(inode, fileBlock);
+      if (!block) break;
+
+      buffer = BufferCache::instance().getZeroed(*_device, block);
+    }
+
+    if (!buffer) break;
+
+    memcpy(buffer->data + offsetInBlock, (void *)source, bytes);
+    BufferCache::instance().markDirty(buffer);
+    BufferCache::instance().release(buffer);
+
+    source += bytes;
+    offset += bytes;
+    size -= bytes;
+    bytesWritten += bytes;
+  }
+
+  if (offset > inode.size()) {
+    inode.data().sizeInBytes = offset;
+    inode.data().sizeInSectors = (offset + SECTOR_SIZE - 1) / SECTOR_SIZE;
+    inode.markDirty();
+  }
+
+  // The periodic flush only writes the buffer cache back and doesn't read inode table blocks, so the new size
+  // and block mappings are copied into the buffer cache now
+  if (inode._dirty) InodeCache::instance().writeBack(&inode);
+
+  return bytesWritten;
+}
+
+uint32_t VirtualFileSystem::allocateBlock(Inode& inode, uint32_t fileBlock) {
+  if (!BlockAllocator::exists()) return 0;
+
+  if (!inode._reservedBlocks) {
+    // Right after the previous block of the file, or in the locality group of the inode
+    // (makeImage gives the files of a directory consecutive inode numbers)
+    uint32_t previous = fileBlock ? mapBlock(inode.data(), fileBlock - 1) : 0;
+    uint32_t goal = previous ? previous + 1 : BlockAllocator::instance().groupGoal(inode.number());
+
+    inode._reservedBlock = BlockAllocator::instance().allocate(goal, PREALLOCATION_BLOCKS, inode._reservedBlocks);
+    if (!inode._reservedBlocks) return 0;
+  }
+
+  uint32_t block = inode._reservedBlock;
+
+  if (!setBlock(inode, fileBlock, block)) return 0;
+
+  inode._reservedBlock++;
+  inode._reservedBlocks--;
+  inode.markDirty();
+
+  return block;
+}
+
+bool VirtualFileSystem::setBlock(Inode& inode, uint32_t fileBlock, uint32_t block) {
+  if (inode.data().flags & INODE_FLAG_EXTENTS) return setExtent(inode.data(), fileBlock, block);
+
+  return setBlockPointer(inode.data(), fileBlock, block);
 }
 
 /*
- * Since we haven't enable interrupts, we need to wait until the disk answers
+ * The block extends the last extent when it follows it both in the file and on disk, otherwise a new extent is appended
+ * to the last leaf. When the leaf is full, a new branch is added under the deepest node of the last path with room,
+ * and when none has room the records of the root are moved to a new block, one level down
  */
-void VirtualFileSystem::waitDisk(void) {
-  // Wait for disk ready.
-  while((IO::inb(DISK_PORT_BASE + 7) & 0xC0) != 0x40); // TODO: explain https://youtu.be/fZY1zr_nW6c?list=PLiUHDN3DAZZX_uTTp0l8QppxK3giZM2bC
+bool VirtualFileSystem::setExtent(struct inode& inode, uint32_t fileBlock, uint32_t block) {
+  // The root isn't aligned in the packed inode, it's changed in an aligned copy
+  uint32_t root[INODE_DIRECT_BLOCKS];
+  memcpy(root, (void *)inode.extentRoot, sizeof(root));
+
+  struct extentHeader *path[EXTENT_MAX_DEPTH + 1];
+  Buffer *buffers[EXTENT_MAX_DEPTH + 1] = { };
+
+  path[0] = (struct extentHeader *)root;
+
+  if (path[0]->magic != EXTENT_MAGIC) {
+    path[0]->magic = EXTENT_MAGIC;
+    path[0]->entries = 0;
+    path[0]->maxEntries = INODE_EXTENTS;
+    path[0]->depth = 0;
+  }
+
+  uint32_t depth = path[0]->depth;
+  if (depth > EXTENT_MAX_DEPTH) return false;
+
+  // Extents are sorted and only appended, so they always go to the last leaf
+  uint32_t level = 0;
+  while (level < depth && path[level]->entries) {
+    const struct extentIndex *indexes = (const struct extentIndex *)(path[level] + 1);
+
+    buffers[level + 1] = BufferCache::instance().get(*_device, indexes[path[level]->entries - 1].childBlock);
+    if (!buffers[level + 1]) break;
+
+    path[level + 1] = (struct extentHeader *)buffers[level + 1]->data;
+    if (path[level + 1]->magic != EXTENT_MAGIC) break;
+
+    level++;
+  }
+
+  bool result = level == depth && appendExtent(path, buffers, fileBlock, block);
+
+  for (uint32_t i = 1; i <= depth; i++) BufferCache::instance().release(buffers[i]);
+
+  if (result) memcpy(inode.extentRoot, root, sizeof(root));
+  return result;
+}
+
+bool VirtualFileSystem::appendExtent(struct extentHeader **path, Buffer **buffers, uint32_t fileBlock, uint32_t block) {
+  uint32_t depth = path[0]->depth;
+  struct extentHeader *leaf = path[depth];
+  struct extent *extents = (struct extent *)(leaf + 1);
+
+  if (leaf->entries) {
+    struct extent& last = extents[leaf->entries - 1];
+
+    if (fileBlock < last.fileBlock + last.length) return false;
+
+    if (fileBlock == last.fileBlock + last.length && block == last.startBlock + last.length) {
+      last.length++;
+      if (depth) BufferCache::instance().markDirty(buffers[depth]);
+      return true;
+    }
+  }
+
+  if (leaf->entries < leaf->maxEntries) {
+    extents[leaf->entries].fileBlock = fileBlock;
+    extents[leaf->entries].startBlock = block;
+    extents[leaf->entries].length = 1;
+    leaf->entries++;
+
+    if (depth) BufferCache::instance().markDirty(buffers[depth]);
+    return true;
+  }
+
+  // Deepest node of the path with room for one more record, the root grows a level when there is none
+  int32_t parent = (int32_t)depth - 1;
+  while (parent >= 0 && path[parent]->entries == path[parent]->maxEntries) parent--;
+
+  bool grow = parent < 0;
+  if (grow && depth == EXTENT_MAX_DEPTH) return false;
+
+  uint32_t branchDepth = grow ? depth + 1 : depth - parent;
+  uint32_t branch = block;
+  uint32_t branchBlocks[EXTENT_MAX_DEPTH + 1];
+
+  // The branch is built from its leaf up, every node holds a single record
+  for (uint32_t i = 0; i < branchDepth; i++) {
+    branchBlocks[i] = newExtentNode(block, i, fileBlock, branch);
+
+    if (!branchBlocks[i]) {
+      while (i--) BlockAllocator::instance().free(branchBlocks[i], 1);
+      return false;
+    }
+
+    branch = branchBlocks[i];
+  }
+
+  if (grow) {
+    uint32_t allocated;
+    uint32_t child = BlockAllocator::instance().allocate(block, 1, allocated);
+    Buffer *buffer = allocated ? BufferCache::instance().getZeroed(*_device, child) : NULL;
+
+    if (!buffer) {
+      if (allocated) BlockAllocator::instance().free(child, 1);
+      for (uint32_t i = 0; i < branchDepth; i++) BlockAllocator::instance().free(branchBlocks[i], 1);
+      return false;
+    }
+
+    struct extentHeader *root = path[0];
+    struct extentHeader *header = (struct extentHeader *)buffer->data;
+    struct extentIndex *index = (struct extentIndex *)(root + 1);
+
+    memcpy(header, root, sizeof(struct extentHeader) + root->entries * sizeof(struct extent));
+    header->maxEntries = BLOCK_EXTENTS;
+    BufferCache::instance().markDirty(buffer);
+    BufferCache::instance().release(buffer);
+
+    // The first record keeps its file block, it's at the same place in both kinds of records
+    index->childBlock = child;
+    index->unused = 0;
+    root->entries = 1;
+    root->depth++;
+    parent = 0;
+  }
+
+  struct extentIndex *indexes = (struct extentIndex *)(path[parent] + 1);
+
+  indexes[path[parent]->entries].fileBlock = fileBlock;
+  indexes[path[parent]->entries].childBlock = branch;
+  indexes[path[parent]->entries].unused = 0;
+  path[parent]->entries++;
+
+  if (parent) BufferCache::instance().markDirty(buffers[parent]);
+  return true;
+}
+
+uint32_t VirtualFileSystem::newExtentNode(uint32_t goal, uint16_t depth, uint32_t fileBlock, uint32_t target) {
+  uint32_t allocated;
+  uint32_t node = BlockAllocator::instance().allocate(goal, 1, allocated);
+  if (!allocated) return 0;
+
+  Buffer *buffer = BufferCache::instance().getZeroed(*_device, node);
+  if (!buffer) {
+    BlockAllocator::instance().free(node, 1);
+    return 0;
+  }
+
+  struct extentHeader *header = (struct extentHeader *)buffer->data;
+  header->magic = EXTENT_MAGIC;
+  header->entries = 1;
+  header->maxEntries = BLOCK_EXTENTS;
+  header->depth = depth;
+
+  if (depth) {
+    struct extentIndex *index = (struct extentIndex *)(header + 1);
+    index->fileBlock = fileBlock;
+    index->childBlock = target;
+  } else {
+    struct extent *extent = (struct extent *)(header + 1);
+    extent->fileBlock = fileBlock;
+    extent->startBlock = target;
+    extent->length = 1;
+  }
+
+  BufferCache::instance().markDirty(buffer);
+  BufferCache::instance().release(buffer);
+
+  return node;
+}
+
+bool VirtualFileSystem::setBlockPointer(struct inode& inode, uint32_t fileBlock, uint32_t block) {
+  if (fileBlock < INODE_INDIRECT_FIRST_BLOCK) {
+    inode.directDataBlocks[fileBlock] = block;
+    return true;
+  }
+
+  if (fileBlock < INODE_DOUBLE_INDIRECT_FIRST_BLOCK) {
+    uint32_t indirectBlock = setPointer(inode.indirectBlock, fileBlock - INODE_INDIRECT_FIRST_BLOCK, block, block);
+    if (!indirectBlock) return false;
+
+    inode.indirectBlock = indirectBlock;
+    return true;
+  }
+
+  uint32_t offset = fileBlock - INODE_DOUBLE_INDIRECT_FIRST_BLOCK;
+  if (offset / POINTERS_PER_BLOCK >= POINTERS_PER_BLOCK) return false;
+
+  // Allocate the single indirect block first if needed, then point the double indirect block to it
+  const uint32_t *indirect = pointerBlock(inode.doubleIndirectBlock);
+  uint32_t previousIndirectBlock = indirect ? indirect[offset / POINTERS_PER_BLOCK] : 0;
+
+  uint32_t indirectBlock = setPointer(previousIndirectBlock, offset % POINTERS_PER_BLOCK, block, block);
+  if (!indirectBlock) return false;
+  if (indirectBlock == previousIndirectBlock) return true;
+
+  uint32_t doubleIndirectBlock = setPointer(inode.doubleIndirectBlock, offset / POINTERS_PER_BLOCK, indirectBlock, block);
+  if (!doubleIndirectBlock) {
+    BlockAllocator::instance().free(indirectBlock, 1);
+    return false;
+  }
+
+  inode.doubleIndirectBlock = doubleIndirectBlock;
+  return true;
+}
+
+uint32_t VirtualFileSystem::setPointer(uint32_t pointerBlock, uint32_t index, uint32_t value, uint32_t goal) {
+  Buffer *buffer;
+
+  if (pointerBlock) {
+    buffer = BufferCache::instance().get(*_device, pointerBlock);
+  } else {
+    uint32_t allocated;
+    uint32_t block = BlockAllocator::instance().allocate(goal, 1, allocated);
+    if (!allocated) return 0;
+
+    buffer = BufferCache::instance().getZeroed(*_device, block);
+    if (!buffer) {
+      BlockAllocator::instance().free(block, 1);
+      return 0;
+    }
+
+    pointerBlock = block;
+  }
+
+  if (!buffer) return 0;
+
+  ((uint32_t *)buffer->data)[index] = value;
+  BufferCache::instance().markDirty(buffer);
+  BufferCache::instance().release(buffer);
+
+  // Keep the copy in the pointer block cache up to date
+  uint32_t slot = pointerBlock % POINTER_BLOCK_CACHE_SLOTS;
+  if (_pointerBlocks[slot] == pointerBlock) pointerBlockData[slot][index] = value;
+
+  return pointerBlock;
+}
+
+void VirtualFileSystem::readAhead(const struct inode& inode, ReadAheadWindow& window, uint32_t fileBlock) {
+  uint32_t fileBlocks = (inode.sizeInBytes + BLOCK_SIZE - 1) / BLOCK_SIZE;
+
+  // Still in the block read last time
+  if (window.nextBlock && fileBlock + 1 == window.nextBlock) return;
+
+  bool sequential = fileBlock == window.nextBlock;
+  window.nextBlock = fileBlock + 1;
+
+  if (!sequential) {
+    window.size = 0;
+    return;
+  }
+
+  uint32_t from;
+
+  if (!window.size) {
+    // First sequential read, prefetch right after it
+    window.size = READAHEAD_INITIAL_BLOCKS;
+    from = fileBlock + 1;
+  } else if (fileBlock >= window.start) {
+    // The reader got to the window being prefetched, prefetch the next one
+    window.size = window.size * 2 < READAHEAD_MAX_BLOCKS ? window.size * 2 : READAHEAD_MAX_BLOCKS;
+    from = window.end;
+  } else {
+    return;
+  }
+
+  window.start = from;
+  window.end = from + window.size < fileBlocks ? from + window.size : fileBlocks;
+
+  // Plugged, so the blocks contiguous on disk are merged into multi-sector requests
+  _device->plug();
+
+  for (uint32_t fileBlock = window.start; fileBlock < window.end; fileBlock++) {
+    uint32_t block = mapBlock(inode, fileBlock);
+    if (block) BufferCache::instance().prefetch(*_device, block);
+  }
+
+  _device->unplug();
+}
+
+Inode* VirtualFileSystem::resolvePath(const char *path) {
+  if (*path != '/') return NULL;
+
+  Inode *inode = InodeCache::instance().get(ROOT_DIRECTORY_INODE);
+
+  while (inode) {
+    while (*path == '/') path++;
+    if (!*path) return inode;
+
+    const char *name = path;
+    while (*path && *path != '/') path++;
+    uint32_t length = path - name;
+
+    if (length == 1 && name[0] == '.') continue;
+
+    if (!inode->isDirectory()) break;
+
+    // A directory that can't be read isn't cached, so the lookup is tried again next time
+    uint32_t number;
+    if (!DentryCache::instance().lookup(inode->number(), name, length, number)) {
+      if (findEntry(*inode, name, length, number)) DentryCache::instance().add(inode->number(), name, length, number);
+      else number = 0;
+    }
+
+    InodeCache::instance().release(inode);
+    if (!number) return NULL;
+
+    inode = InodeCache::instance().get(number);
+  }
+
+  InodeCache::instance().release(inode);
+  return NULL;
 }
 
 /*
- * Read from the specified 'sector' and put in 'destination'
+ * A hashed directory is looked up in its index block and a single bucket block, a flat one is scanned in order
  */
-void VirtualFileSystem::readSector(uint8_t *destination, uint32_t sector) {
-  waitDisk();
-  
-  // Issue command
-  IO::outb(DISK_PORT_BASE + 2, 1); // count = 1 sector 
-  IO::outb(DISK_PORT_BASE + 3, sector); // Take the 1st LSB
-  IO::outb(DISK_PORT_BASE + 4, sector >> 8); // Take the 2nd LSB
-  IO::outb(DISK_PORT_BASE + 5, sector >> 16); // Take the 3rd LSB
-  IO::outb(DISK_PORT_BASE + 6, (sector >> 24) | 0xE0); // Take the 4th LSB (the MSB now)
-                                                       // 0xE0 -> 0b1110_0000
-                                                       // bit 4: drive number (0 in our case)
-                                                       // bit 5: always set
-                                                       // bit 6: set for LBA
-                                                       // bit 7: always set
-  IO::outb(DISK_PORT_BASE + 7, DISK_READ_CMD); // cmd 0x20 - read sectors
-
-  // Read data
-  waitDisk();
-  IO::insl(DISK_PORT_BASE, destination, SECTOR_SIZE / 4); // Read 4-bytes 128 times, getting the 512 bytes
+bool VirtualFileSystem::findEntry(const Inode& directory, const char *name, uint32_t length, uint32_t& number) {
+  number = 0;
+
+  if (length > DIRECTORY_ENTRY_NAME_LENGTH) return true;
+
+  if (directory.data().flags & INODE_FLAG_HASHED_DIRECTORY) {
+    uint32_t indexBlock = mapBlock(directory.data(), 0);
+    if (!indexBlock) return false;
+
+    Buffer *buffer = BufferCache::instance().get(*_device, indexBlock);
+    if (!buffer) return false;
+
+    struct directoryIndex *index = (struct directoryIndex *)buffer->data;
+    uint32_t buckets = index->magic == DIRECTORY_INDEX_MAGIC ? index->buckets : 0;
+    BufferCache::instance().release(buffer);
+
+    if (!buckets) return false;
+
+    uint32_t block = mapBlock(directory.data(), 1 + directoryNameHash(name, length) % buckets);
+    if (!block) return false;
+
+    return findEntryInBlock(block, DIRECTORY_ENTRIES_PER_BLOCK, name, length, number);
+  }
+
+  uint32_t entries = directory.size() / sizeof(struct directoryEntry);
+
+  for (uint32_t fileBlock = 0; fileBlock * DIRECTORY_ENTRIES_PER_BLOCK < entries; fileBlock++) {
+    uint32_t blockEntries = entries - fileBlock * DIRECTORY_ENTRIES_PER_BLOCK;
+    if (blockEntries > DIRECTORY_ENTRIES_PER_BLOCK) blockEntries = DIRECTORY_ENTRIES_PER_BLOCK;
+
+    uint32_t block = mapBlock(directory.data(), fileBlock);
+    if (!block) return false;
+
+    if (!findEntryInBlock(block, blockEntries, name, length, number)) return false;
+    if (number) return true;
+  }
+
+  return true;
+}
+
+bool VirtualFileSystem::findEntryInBlock(uint32_t block, uint32_t entries, const char *name, uint32_t length, uint32_t& number) {
+  Buffer *buffer = BufferCache::instance().get(*_device, block);
+  if (!buffer) return false;
+
+  struct directoryEntry *entry = (struct directoryEntry *)buffer->data;
+  number = 0;
+
+  for (uint32_t i = 0; i < entries && !number; i++, entry++) {
+    if (!entry->inodeNumber) continue;
+
+    uint32_t j = 0;
+    while (j < length && entry->name[j] == name[j]) j++;
+
+    if (j == length && (length == DIRECTORY_ENTRY_NAME_LENGTH || !entry->name[length])) number = entry->inodeNumber;
+  }
+
+  BufferCache::instance().release(buffer);
+  return true;
 }
@@ -1,21 +1,132 @@
 #pragma once
 #include "kernel/fileSystem/fs.h"
+#include <kernel/fileSystem/ReadAheadWindow.h>
+#include <stddef.h>
+
+class BlockDevice;
+class Inode;
+struct Buffer;
+
+#define SUPERBLOCK_BLOCK 1
+#define POINTER_BLOCK_CACHE_SLOTS 8 // Indirect blocks whose pointers are kept by the VFS
 
 class VirtualFileSystem {
   public:
     VirtualFileSystem();
     static VirtualFileSystem& instance();
 
+    /*
+     * Block device holding the file system, every block is read through the buffer cache
+     */
+    void setDevice(BlockDevice& device);
+
     void loadSuperBlock();
-    static void readSector(uint8_t *destination, uint32_t sector);
+
+    /*
+     * Copy the given inode from the inode table into 'result'
+     */
+    bool readInode(uint32_t number, struct inode& result);
+
+    /*
+     * Copy the given inode into the inode table, it's written to the disk with its block
+     */
+    bool writeInode(uint32_t number, const struct inode& inode);
+
+    /*
+     * Disk block holding the given file block (through the block pointers or the extent tree), 0 if it's not mapped
+     * 'contiguous', if given, is set to the number of file blocks from this one that follow it on disk
+     */
+    uint32_t mapBlock(const struct inode& inode, uint32_t fileBlock, uint32_t *contiguous = NULL);
+
+    /*
+     * Read up to 'size' bytes of the file data of the given inode starting at 'offset'
+     * Sequential reads prefetch the following blocks when a read-ahead window is given
+     * Returns the number of bytes read
+     */
+    uint32_t read(const struct inode& inode, uint32_t offset, uint8_t *destination, uint32_t size, ReadAheadWindow *window);
+
+    /*
+     * Write up to 'size' bytes of file data of the given inode starting at 'offset' (at most its size)
+     * The file grows as needed, its new blocks are allocated near its previous ones
+     * The blocks are only modified in the buffer cache, they are written back to the disk later
+     * Returns the number of bytes written
+     */
+    uint32_t write(Inode& inode, uint32_t offset, const uint8_t *source, uint32_t size);
+
+    /*
+     * Walk the given absolute path ("/kernel") from the root directory
+     * Every component is looked up in the dentry cache first, directories are only scanned on a miss
+     * Returns the referenced inode (to be given back with InodeCache::release), NULL if it doesn't exist
+     */
+    Inode* resolvePath(const char *path);
+
+    /*
+     * Set 'number' to the inode number of the entry 'name' ('length' bytes) of the given directory, 0 if there is none
+     * Reads the directory (flat or hashed), without going through the dentry cache
+     * Returns false if the directory can't be read, so a failed read isn't taken for a missing entry
+     */
+    bool findEntry(const Inode& directory, const char *name, uint32_t length, uint32_t& number);
 
     int test;
     struct superBlock _superBlock;
 
   private:
-    static void waitDisk(void);
+    /*
+     * Map a file block through the direct, indirect and double indirect block pointers
+     */
+    uint32_t mapBlockPointers(const struct inode& inode, uint32_t fileBlock, uint32_t *contiguous);
+
+    /*
+     * Block numbers held by the given indirect block, NULL if it can't be read
+     * The pointers of the last indirect blocks used are copied into a small direct mapped cache, so sequential reads
+     * don't look them up again, the pointer is valid until the next call
+     */
+    const uint32_t* pointerBlock(uint32_t block);
+
+    /*
+     * Allocate a block for the given file block and map it, returns 0 if the disk is full or it can't be mapped
+     * Blocks come from the pre-allocation of the inode, refilled with up to PREALLOCATION_BLOCKS contiguous blocks
+     */
+    uint32_t allocateBlock(Inode& inode, uint32_t fileBlock);
+
+    /*
+     * Map the file block to the given disk block, in the extent tree or the block pointers
+     * Returns false if a block needed for the tree or a pointer block can't be allocated
+     */
+    bool setBlock(Inode& inode, uint32_t fileBlock, uint32_t block);
+    bool setExtent(struct inode& inode, uint32_t fileBlock, uint32_t block);
+
+    /*
+     * Append the extent to the last leaf of the tree, 'path' holds the nodes from the root down to that leaf
+     * (read from 'buffers', except the root), new nodes are allocated near 'block' when the leaf is full
+     */
+    bool appendExtent(struct extentHeader **path, Buffer **buffers, uint32_t fileBlock, uint32_t block);
+
+    /*
+     * Allocate an extent tree node near 'goal' holding a single record mapping 'fileBlock' to 'target'
+     * (a data block for a leaf, a child node otherwise), returns its block, 0 if it can't be allocated
+     */
+    uint32_t newExtentNode(uint32_t goal, uint16_t depth, uint32_t fileBlock, uint32_t target);
+    bool setBlockPointer(struct inode& inode, uint32_t fileBlock, uint32_t block);
+
+    /*
+     * Set the given entry of a pointer block, allocating the pointer block (near 'goal') if it's 0
+     * Returns the pointer block, 0 if it couldn't be allocated or read
+     */
+    uint32_t setPointer(uint32_t pointerBlock, uint32_t index, uint32_t value, uint32_t goal);
+
+    /*
+     * Set 'number' to the inode number of the entry 'name' among the first 'entries' entries of the given block,
+     * 0 if there is none, returns false if the block can't be read
+     */
+    bool findEntryInBlock(uint32_t block, uint32_t entries, const char *name, uint32_t length, uint32_t& number);
+
+    /*
+     * Update the read-ahead window for a read of the given file block, prefetching the next window if needed
+     */
+    void readAhead(const struct inode& inode, ReadAheadWindow& window, uint32_t fileBlock);
 
+    BlockDevice *_device { NULL };
 
-    uint8_t tempSector[SECTOR_SIZE];
-    uint8_t tempBlock[BLOCK_SIZE];
+    uint32_t _pointerBlocks[POINTER_BLOCK_CACHE_SLOTS] { }; // Block cached in each slot, 0 if none
 };
@@ -0,0 +1,87 @@
+#pragma once
+#include <stdint.h>
+
+/*
+ * Data block bitmap helpers, shared by makeImage and the kernel block allocator
+ * Block i is bit (i % 8) of byte (i / 8), a set bit means the block is used
+ */
+
+#define BLOCKS_PER_GROUP 1024 // 4 MiB locality groups
+
+/*
+ * First block of the locality group of the given directory, where the blocks of its files are looked for first
+ * Directories are spread over the groups by inode number
+ */
+static inline uint32_t blockGroupGoal(uint32_t first, uint32_t total, uint32_t directory) {
+  uint32_t groups = (total - first + BLOCKS_PER_GROUP - 1) / BLOCKS_PER_GROUP;
+
+  return first + (directory % groups) * BLOCKS_PER_GROUP;
+}
+
+static inline int blockBitmapTest(const uint8_t *bitmap, uint32_t block) {
+  return (bitmap[block / 8] >> (block % 8)) & 1;
+}
+
+static inline void blockBitmapSet(uint8_t *bitmap, uint32_t block, uint32_t count) {
+  for (; count; block++, count--) bitmap[block / 8] |= 1 << (block % 8);
+}
+
+static inline void blockBitmapClear(uint8_t *bitmap, uint32_t block, uint32_t count) {
+  for (; count; block++, count--) bitmap[block / 8] &= ~(1 << (block % 8));
+}
+
+/*
+ * Find free blocks among [first, total), starting at 'goal' and wrapping around to 'first'
+ * Returns the first block of the first run of at least 'count' free blocks, or of the longest run found
+ * if there is none, with its usable length (up to 'count') in 'length'; 'length' is 0 if every block is used
+ *
+ * Runs are measured from the goal onwards, so a file keeps growing right after its last block when it can
+ */
+static inline uint32_t blockBitmapFindRun(const uint8_t *bitmap, uint32_t first, uint32_t total, uint32_t goal, uint32_t count, uint32_t *length) {
+  uint32_t bestStart = 0;
+  uint32_t bestLength = 0;
+  uint32_t block = goal < first || goal >= total ? first : goal;
+  uint32_t scanned = 0;
+
+  while (scanned < total - first) {
+    // Skip whole used bytes
+    if (block % 8 == 0 && bitmap[block / 8] == 0xFF && block + 8 <= total) {
+      block += 8;
+      scanned += 8;
+      if (block >= total) block = first;
+      continue;
+    }
+
+    if (blockBitmapTest(bitmap, block)) {
+      block++;
+      scanned++;
+      if (block >= total) block = first;
+      continue;
+    }
+
+    // A run can't wrap around the end of the bitmap
+    uint32_t start = block;
+    uint32_t run = 0;
+
+    while (block < total && run < count && !blockBitmapTest(bitmap, block)) {
+      block++;
+      run++;
+    }
+    scanned += run;
+
+    if (run == count) {
+      *length = run;
+      return start;
+    }
+
+    if (run > bestLength) {
+      bestStart = start;
+      bestLength = run;
+    }
+
+    if (block >= total) block = first;
+  }
+
+  *length = bestLength;
+  return bestStart;
+}
@@ -3,9 +3,49 @@
 
 #define SECTOR_SIZE 512
 #define BLOCK_SIZE 4096
+#define SECTORS_PER_BLOCK (BLOCK_SIZE / SECTOR_SIZE)
 
 #define ROOT_DIRECTORY_INODE 1
 
+#define INODE_DIRECT_BLOCKS 25
+#define POINTERS_PER_BLOCK (BLOCK_SIZE / sizeof(uint32_t))
+
+/*
+ * Without extents, the file blocks after the direct ones are mapped by the single indirect block
+ * (POINTERS_PER_BLOCK block numbers), then by the double indirect block (POINTERS_PER_BLOCK single indirect blocks)
+ * A block number of 0 is a hole
+ */
+#define INODE_INDIRECT_FIRST_BLOCK INODE_DIRECT_BLOCKS
+#define INODE_DOUBLE_INDIRECT_FIRST_BLOCK (INODE_INDIRECT_FIRST_BLOCK + POINTERS_PER_BLOCK)
+
+#define DIRECTORY_ENTRY_NAME_LENGTH 60
+#define DIRECTORY_ENTRIES_PER_BLOCK (BLOCK_SIZE / sizeof(struct directoryEntry))
+
+/*
+ * Hashed directories
+ *
+ * A directory whose entries don't fit in a single block is written as a hash table:
+ * the first block holds a struct directoryIndex, and the entries of the names hashing to bucket b
+ * (directoryNameHash(name) % buckets) are stored in the file block 1 + b
+ * Unused entries of a bucket block have the inode number 0
+ * Directories without INODE_FLAG_HASHED_DIRECTORY are flat arrays of entries, scanned in order
+ */
+#define INODE_FLAG_HASHED_DIRECTORY 0x1
+#define DIRECTORY_INDEX_MAGIC 0x58444948 // "HIDX"
+
+/*
+ * Extents
+ *
+ * With INODE_FLAG_EXTENTS, the direct blocks of the inode hold the root of an extent tree instead:
+ * a struct extentHeader followed by up to INODE_EXTENTS records
+ * In a leaf (depth 0) the records are struct extent, runs of contiguous disk blocks
+ * In an index node they are struct extentIndex, each pointing to a block holding a node one level deeper
+ * (a header followed by up to BLOCK_EXTENTS records)
+ * The records of a node are sorted by file block
+ */
+#define INODE_FLAG_EXTENTS 0x2
+#define EXTENT_MAGIC 0xF30A
+
 enum FileType : uint8_t {
   FILETYPE_FILE = 0,
   FILETYPE_DIRECTORY = 1,
@@ -37,15 +77,63 @@ struct superBlock {
 struct inode {
   uint32_t number; // INode number (The low level name of a file)
   uint32_t referenceCounter; // Reference counter
-  uint32_t directDataBlocks[25]; // Direct data blocks (25 * 4096 = 49152 bytes), TODO: improve this
+  union {
+    uint32_t directDataBlocks[INODE_DIRECT_BLOCKS]; // Direct data blocks (25 * 4096 = 102400 bytes)
+    uint8_t extentRoot[INODE_DIRECT_BLOCKS * sizeof(uint32_t)]; // With INODE_FLAG_EXTENTS
+  };
   uint8_t type; // Wheter is a file or a directory (by now)
   uint32_t sizeInBytes; 
   uint32_t sizeInSectors;
+  uint8_t flags; // INODE_FLAG_*
+  uint32_t indirectBlock; // Without INODE_FLAG_EXTENTS, 0 if not allocated
+  uint32_t doubleIndirectBlock;
 
-  uint8_t padding[11]; // unused, to reach sizeof(struct inode) = 128
+  uint8_t padding[2]; // unused, to reach sizeof(struct inode) = 128
 } __attribute__((packed));
 
 struct directoryEntry {
-  char name[60];
+  char name[DIRECTORY_ENTRY_NAME_LENGTH]; // Null terminated unless it takes the whole field
   uint32_t inodeNumber; 
 };
+
+struct extentHeader {
+  uint16_t magic; // EXTENT_MAGIC
+  uint16_t entries;
+  uint16_t maxEntries;
+  uint16_t depth; // 0 for a leaf
+};
+
+struct extent {
+  uint32_t fileBlock; // First file block of the run
+  uint32_t startBlock; // First disk block of the run
+  uint32_t length; // Blocks in the run
+};
+
+struct extentIndex {
+  uint32_t fileBlock; // First file block covered by the child
+  uint32_t childBlock; // Disk block holding the child node
+  uint32_t unused;
+};
+
+#define INODE_EXTENTS ((INODE_DIRECT_BLOCKS * sizeof(uint32_t) - sizeof(struct extentHeader)) / sizeof(struct extent))
+#define BLOCK_EXTENTS ((BLOCK_SIZE - sizeof(struct extentHeader)) / sizeof(struct extent))
+
+struct directoryIndex {
+  uint32_t magic; // DIRECTORY_INDEX_MAGIC
+  uint32_t buckets; // Bucket blocks following the index block
+  uint32_t entries;
+};
+
+/*
+ * FNV-1a hash of a directory entry name ('length' bytes), shared by makeImage and the kernel
+ */
+static inline uint32_t directoryNameHash(const char *name, uint32_t length) {
+  uint32_t hash = 2166136261u;
+
+  for (uint32_t i = 0; i < length; i++) {
+    hash ^= (uint8_t)name[i];
+    hash *= 16777619u;
+  }
+
+  return hash;
+}
@@ -0,0 +1,91 @@
+#include <x86/x86.h>
+#include <kernel/fileSystem/poll.h>
+#include <kernel/fileSystem/File.h>
+#include <kernel/fileSystem/FileDescription.h>
+#include <kernel/fileSystem/FileDescriptorTable.h>
+#include <kernel/fileSystem/BufferCache.h>
+#include <kernel/interrupts/pic.h>
+#include <kernel/time/sharedPage.h>
+
+namespace Poll {
+
+/*
+ * Fill the returned events of every descriptor, returns the number of ready descriptors
+ */
+static uint32_t check(PollDescriptor *descriptors, uint32_t count) {
+  uint32_t ready = 0;
+
+  for (uint32_t i = 0; i < count; i++) {
+    PollDescriptor& descriptor = descriptors[i];
+    FileDescription *description = FileDescriptorTable::current().get(descriptor.fd);
+
+    descriptor.returnedEvents = 0;
+
+    if (!description) {
+      descriptor.returnedEvents = POLL_INVALID;
+      ready++;
+      continue;
+    }
+
+    if ((descriptor.events & POLL_IN) && description->canRead()) descriptor.returnedEvents |= POLL_IN;
+    if ((descriptor.events & POLL_OUT) && description->canWrite()) descriptor.returnedEvents |= POLL_OUT;
+
+    if (descriptor.returnedEvents) ready++;
+  }
+
+  return ready;
+}
+
+/*
+ * Sum of the wake up counts of the files of the descriptors, it changes when any of them is woken up
+ */
+static uint32_t wakeUpsOf(PollDescriptor *descriptors, uint32_t count) {
+  uint32_t wakeUps = 0;
+
+  for (uint32_t i = 0; i < count; i++) {
+    FileDescription *description = FileDescriptorTable::current().get(descriptors[i].fd);
+    if (description) wakeUps += description->file().waitQueue().wakeUps();
+  }
+
+  return wakeUps;
+}
+
+/*
+ * Milliseconds to PIT ticks, rounded up (without a 64 bit division)
+ */
+static inline uint32_t toTicks(int32_t milliseconds) {
+  if (milliseconds <= 0) return 0;
+
+  return milliseconds / 1000 * PIT_TICK_FREQUENCY + (milliseconds % 1000 * PIT_TICK_FREQUENCY + 999) / 1000;
+}
+
+int32_t poll(PollDescriptor *descriptors, uint32_t count, int32_t timeout) {
+  uint32_t flags = disableInterrupts();
+  uint64_t deadline = SharedPage::data().ticks + toTicks(timeout);
+  uint32_t ready;
+
+  // Files are checked with interrupts disabled, so a wake up can't be lost before halting
+  for (;;) {
+    uint32_t wakeUps = wakeUpsOf(descriptors, count);
+    ready = check(descriptors, count);
+
+    if (ready || !timeout) break;
+
+    // Halt until one of the files is woken up, the timer wakes the CPU up to check the timeout
+    // The kernel is idle meanwhile, so it's where the periodic flush runs
+    while (wakeUpsOf(descriptors, count) == wakeUps && (timeout < 0 || SharedPage::data().ticks < deadline)) {
+      asm volatile("sti\n hlt\n cli");
+      BufferCache::flushIfDue();
+    }
+
+    if (timeout > 0 && SharedPage::data().ticks >= deadline) {
+      ready = check(descriptors, count);
+      break;
+    }
+  }
+
+  restoreInterrupts(flags);
+  return ready;
+}
+
+}
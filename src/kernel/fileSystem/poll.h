@@ -0,0 +1,15 @@
+#pragma once
+#include <stdint.h>
+#include <pollDescriptor.h>
+
+namespace Poll {
+
+/*
+ * Wait until one of the file descriptors of the running process is ready for the requested events
+ * The CPU halts in between, it's woken up by the wait queues of the files (or the timer, for the timeout)
+ * 'timeout' is in milliseconds, 0 only checks the descriptors and -1 waits forever
+ * Returns the number of descriptors with returned events, 0 on timeout
+ */
+int32_t poll(PollDescriptor *descriptors, uint32_t count, int32_t timeout);
+
+}
@@ -0,0 +1,14 @@
+#include <x86/x86.h>
+#include <kernel/interrupts/pageFault.h>
+#include <kernel/fileSystem/FileMappings.h>
+#include <kernel/utils/kprintf.h>
+
+__attribute__ ((interrupt)) void pageFaultHandler(IntFrame32 *frame, uint32_t errorCode) {
+  VirtualAddress address = readCR2();
+
+  if (!(errorCode & PAGE_FAULT_PRESENT) && FileMappings::instance().handleFault(address, errorCode & PAGE_FAULT_WRITE)) return;
+
+  kprintf("\nPage fault at %lx, eip: %lx, error code: %x", address, frame->eip, errorCode);
+
+  for (;;) asm volatile("cli\n hlt");
+}
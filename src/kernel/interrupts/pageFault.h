@@ -0,0 +1,18 @@
+#pragma once
+#include <stdint.h>
+#include <kernel/interrupts/idt.h>
+
+#define PAGE_FAULT_IDT_ENTRY 14
+
+/*
+ * Page fault error code bits
+ */
+#define PAGE_FAULT_PRESENT 0x1 // The page was present, the access wasn't allowed
+#define PAGE_FAULT_WRITE   0x2 // Caused by a write
+#define PAGE_FAULT_USER    0x4 // Caused in user mode
+
+/*
+ * Handler for the page fault exception, the CPU pushes an error code for it
+ * Faults in the file mapping window map the page, any other fault halts
+ */
+__attribute__ ((interrupt)) void pageFaultHandler(IntFrame32 *frame, uint32_t errorCode);
@@ -2,6 +2,8 @@
 #include <kernel/interrupts/pic.h>
 #include <io.h>
 #include <kernel/utils/kprintf.h>
+#include <kernel/time/sharedPage.h>
+#include <kernel/fileSystem/BufferCache.h>
 
 namespace PIC {
 
@@ -152,6 +154,9 @@ __attribute__ ((interrupt)) void pitIRQ0Handler(IntFrame32 *frame) {
     testt=0;
   }
 
+  SharedPage::onTick();
+  BufferCache::onTick();
+
   sendEOI(PIC_IRQ_TIMER);
 }
 
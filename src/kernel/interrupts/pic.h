@@ -9,6 +9,7 @@
 #include <stdint.h>
 #define PIC_IRQ_TIMER      0
 #define PIC_IRQ_KEYBOARD   1
+#define PIC_IRQ_CASCADE    2
 #define PIC_IRQ_SERIAL_2   3
 #define PIC_IRQ_SERIAL_1   4
 #define PIC_IRQ_PARALLEL_2 5
@@ -99,6 +100,9 @@
 #define PIT_COUNTER_2_PORT    0x42
 #define PIT_CONTROL_WORD_PORT 0x43
 
+#define PIT_BASE_FREQUENCY 1193180 // Frequency (Hz) of the PIT oscillator
+#define PIT_TICK_FREQUENCY 100     // Frequency (Hz) we configure the PIT channel 0 with
+
 namespace PIC {
 
 /*
@@ -10,9 +10,22 @@
 #include <syscallWrappers.h>
 #include <MemoryManager.h>
 #include <kernel/interrupts/pic.h>
+#include <kernel/interrupts/pageFault.h>
 #include <kernel/syscalls/syscalls.h>
+#include <kernel/syscalls/syscallStats.h>
+#include <kernel/time/sharedPage.h>
+#include <kernel/devices/AHCIDevice.h>
+#include <kernel/devices/ATADevice.h>
+#include <kernel/devices/VirtioBlockDevice.h>
 #include <kernel/devices/KeyboardDevice.h>
+#include <kernel/fileSystem/BlockAllocator.h>
+#include <kernel/fileSystem/BufferCache.h>
+#include <kernel/fileSystem/DentryCache.h>
 #include <kernel/fileSystem/File.h>
+#include <kernel/fileSystem/FileMappings.h>
+#include <kernel/fileSystem/FileDescriptorTable.h>
+#include <kernel/fileSystem/InodeCache.h>
+#include <kernel/fileSystem/PageCache.h>
 #include <kernel/heap/kmalloc.h>
 #include <kernel/tty/VirtualConsole.h>
 #include <kernel/utils/kprintf.h>
@@ -36,13 +49,15 @@ extern "C" void OSStart() {
   initIDT();
 
   setIDTDescriptor(0x80, syscallDispatcher, INT_GATE_USER_FLAGS);
+  setIDTDescriptor(PAGE_FAULT_IDT_ENTRY, (void (*)(IntFrame32 *))pageFaultHandler, INT_GATE_FLAGS);
 
   PIC::disableAll();
   PIC::initializePIC();
 
   setIDTDescriptor(PIC_IRQ_0_IDT_ENTRY, PIC::pitIRQ0Handler, INT_GATE_FLAGS);
 
-  PIC::configurePIT(0, 2, 1193180 / 100);
+  PIC::configurePIT(0, 2, PIT_BASE_FREQUENCY / PIT_TICK_FREQUENCY);
+  SharedPage::initialize(PIT_TICK_FREQUENCY);
   
   PIC::enable(PIC_IRQ_TIMER);
   
@@ -53,8 +68,21 @@ extern "C" void OSStart() {
   kprintf("\n\n\n");
 
   // TODO: load VFS
+  new BufferCache;
+  new InodeCache;
+  new PageCache;
+  new DentryCache;
+  new FileMappings;
+  new FileDescriptorTable;
   new VirtualFileSystem;
+
+  // Prefer the virtio disk, then the SATA disk, fall back to the legacy ATA disk
+  BlockDevice *disk = VirtioBlockDevice::create();
+  if (!disk) disk = AHCIDevice::create();
+  if (!disk) disk = new ATADevice();
+  VirtualFileSystem::instance().setDevice(*disk);
   VirtualFileSystem::instance().loadSuperBlock();
+  if (!BlockAllocator::create(*disk, VirtualFileSystem::instance()._superBlock)) kprintf("\nCan't read the data blocks bitmap");
 
   new KeyboardDevice();
 
@@ -65,7 +93,9 @@ extern "C" void OSStart() {
   VirtualConsole *vc2 = new VirtualConsole(1);
   vc->switchTo(0);
   
+  // The console is the standard input, file descriptor 0
   FileDescription *fd = FileDescription::create(*vc);
+  FileDescriptorTable::current().allocate(*fd);
   char buffer[30];
   memset(buffer, 0x0, sizeof(buffer));
   int nRead = 0;
@@ -90,12 +120,32 @@ extern "C" void OSStart() {
   kprintf("firstDataBlock: %d\n", vfs._superBlock.firstDataBlock);
 
   for(;;) {
-    if (nRead < sizeof(buffer))
-      nRead += vc->read(*fd, (uint8_t *)&buffer[nRead], sizeof(buffer));
+    // Sleep until a key is pressed instead of spinning on the console
+    PollDescriptor input = { 0, POLL_IN, 0 };
+    pollWrapper(&input, 1, -1);
+
+    if (nRead < sizeof(buffer)) {
+      int32_t bytes = readWrapper(0, &buffer[nRead], sizeof(buffer) - nRead);
+      if (bytes > 0) nRead += bytes;
+    }
 
     for (int i = 0; i < nRead; i++) {
       if (buffer[i] == '\n') { 
-        kprintf("\nRead buffer:%s \n", buffer);
+        if (strcmp(buffer, "syscalls\n")) SyscallStats::dump();
+        else if (strcmp(buffer, "cache\n")) BufferCache::instance().dump();
+        else if (strcmp(buffer, "inodes\n")) InodeCache::instance().dump();
+        else if (strcmp(buffer, "dentries\n")) DentryCache::instance().dump();
+        else if (strcmp(buffer, "pages\n")) PageCache::instance().dump();
+        else if (strcmp(buffer, "sync\n")) syncWrapper();
+        else if (strcmp(buffer, "mmap\n")) {
+          uint8_t *image = (uint8_t *)mmapWrapper("/kernel");
+          if (image) {
+            kprintf("\n/kernel mapped at %lx: %x %c%c%c", image, image[0], image[1], image[2], image[3]);
+            munmapWrapper(image);
+          }
+        }
+        else kprintf("\nRead buffer:%s \n", buffer);
+
         memset(buffer, 0x0, sizeof(buffer));
         nRead = 0;
         break;
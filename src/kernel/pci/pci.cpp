@@ -0,0 +1,96 @@
+#include <io.h>
+#include <kernel/pci/pci.h>
+
+namespace PCI {
+
+/*
+ * Configuration address: bit 31 enable, bits 16-23 bus, bits 11-15 slot, bits 8-10 function,
+ * bits 2-7 register (dword aligned)
+ */
+static void selectRegister(Address address, uint8_t offset) {
+  IO::outl(PCI_CONFIG_ADDRESS_PORT, 0x80000000
+                                    | (address.bus << 16)
+                                    | (address.slot << 11)
+                                    | (address.function << 8)
+                                    | (offset & 0xFC));
+}
+
+uint32_t read32(Address address, uint8_t offset) {
+  selectRegister(address, offset);
+  return IO::inl(PCI_CONFIG_DATA_PORT);
+}
+
+uint16_t read16(Address address, uint8_t offset) {
+  selectRegister(address, offset);
+  return IO::inw(PCI_CONFIG_DATA_PORT + (offset & 0x2));
+}
+
+uint8_t read8(Address address, uint8_t offset) {
+  selectRegister(address, offset);
+  return IO::inb(PCI_CONFIG_DATA_PORT + (offset & 0x3));
+}
+
+void write32(Address address, uint8_t offset, uint32_t value) {
+  selectRegister(address, offset);
+  IO::outl(PCI_CONFIG_DATA_PORT, value);
+}
+
+void write16(Address address, uint8_t offset, uint16_t value) {
+  selectRegister(address, offset);
+  IO::outw(PCI_CONFIG_DATA_PORT + (offset & 0x2), value);
+}
+
+/*
+ * Brute force scan of every bus, slot and function, calling 'matches' on every present function
+ * Functions other than 0 are only checked on multi function devices (bit 7 of the header type)
+ */
+template<typename Predicate>
+static bool scan(Predicate matches, Address& result) {
+  for (uint16_t bus = 0; bus < PCI_MAX_BUSES; bus++) {
+    for (uint8_t slot = 0; slot < PCI_MAX_SLOTS; slot++) {
+      Address address = { (uint8_t)bus, slot, 0 };
+
+      if (read16(address, PCI_VENDOR_ID) == PCI_NO_VENDOR) continue;
+
+      uint8_t functions = (read8(address, PCI_HEADER_TYPE) & 0x80) ? PCI_MAX_FUNCTIONS : 1;
+
+      for (address.function = 0; address.function < functions; address.function++) {
+        if (read16(address, PCI_VENDOR_ID) == PCI_NO_VENDOR) continue;
+
+        if (matches(address)) {
+          result = address;
+          return true;
+        }
+      }
+    }
+  }
+
+  return false;
+}
+
+bool findDevice(uint8_t classCode, uint8_t subclass, Address& result) {
+  return scan([=](Address address) {
+    return read8(address, PCI_CLASS) == classCode && read8(address, PCI_SUBCLASS) == subclass;
+  }, result);
+}
+
+bool findDeviceByID(uint16_t vendor, uint16_t device, Address& result) {
+  return scan([=](Address address) {
+    return read16(address, PCI_VENDOR_ID) == vendor && read16(address, PCI_DEVICE_ID) == device;
+  }, result);
+}
+
+uint32_t getBAR(Address address, uint8_t bar) {
+  return read32(address, PCI_BAR0 + bar * 4);
+}
+
+void enableBusMastering(Address address) {
+  uint16_t command = read16(address, PCI_COMMAND);
+  write16(address, PCI_COMMAND, command | PCI_COMMAND_IO | PCI_COMMAND_MEMORY | PCI_COMMAND_BUS_MASTER);
+}
+
+uint8_t interruptLine(Address address) {
+  return read8(address, PCI_INTERRUPT_LINE);
+}
+
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include <stdint.h>
+
+/* Ports */
+#define PCI_CONFIG_ADDRESS_PORT 0xCF8
+#define PCI_CONFIG_DATA_PORT    0xCFC
+
+/* Configuration space registers (offsets) */
+#define PCI_VENDOR_ID      0x00
+#define PCI_DEVICE_ID      0x02
+#define PCI_COMMAND        0x04
+#define PCI_PROG_IF        0x09
+#define PCI_SUBCLASS       0x0A
+#define PCI_CLASS          0x0B
+#define PCI_HEADER_TYPE    0x0E
+#define PCI_BAR0           0x10
+#define PCI_INTERRUPT_LINE 0x3C
+
+/* Command register bits */
+#define PCI_COMMAND_IO         0x1 // Respond to I/O space accesses
+#define PCI_COMMAND_MEMORY     0x2 // Respond to memory space accesses
+#define PCI_COMMAND_BUS_MASTER 0x4 // Allow the device to do DMA
+
+/* Class codes */
+#define PCI_CLASS_MASS_STORAGE 0x1
+#define PCI_SUBCLASS_IDE       0x1
+#define PCI_SUBCLASS_SATA      0x6
+
+/* Base address registers */
+#define PCI_BAR_IO       0x1 // Bit 0 set for I/O space BARs
+#define PCI_BAR_IO_MASK  0xFFFFFFFC
+#define PCI_BAR_MEM_MASK 0xFFFFFFF0
+
+#define PCI_NO_VENDOR 0xFFFF // Read as vendor when there is no device
+
+#define PCI_MAX_BUSES     256
+#define PCI_MAX_SLOTS     32
+#define PCI_MAX_FUNCTIONS 8
+
+namespace PCI {
+
+/*
+ * Location of a device function in the PCI configuration space
+ */
+struct Address {
+  uint8_t bus;
+  uint8_t slot;
+  uint8_t function;
+};
+
+/*
+ * Access the configuration space of the given device function through the configuration mechanism #1
+ * The offset must be aligned to the size of the access
+ */
+uint32_t read32(Address address, uint8_t offset);
+uint16_t read16(Address address, uint8_t offset);
+uint8_t read8(Address address, uint8_t offset);
+void write32(Address address, uint8_t offset, uint32_t value);
+void write16(Address address, uint8_t offset, uint16_t value);
+
+/*
+ * Look for the first device function with the given class and subclass
+ * Returns false if there is none
+ */
+bool findDevice(uint8_t classCode, uint8_t subclass, Address& result);
+
+/*
+ * Look for the first device function with the given vendor and device ids
+ * Returns false if there is none
+ */
+bool findDeviceByID(uint16_t vendor, uint16_t device, Address& result);
+
+/*
+ * Read the given base address register (0 - 5)
+ */
+uint32_t getBAR(Address address, uint8_t bar);
+
+/*
+ * Let the device act as bus master so it can do DMA
+ */
+void enableBusMastering(Address address);
+
+uint8_t interruptLine(Address address);
+
+}
@@ -0,0 +1,79 @@
+#include <stdint.h>
+#include <string.h>
+#include <x86/x86.h>
+#include <kernel/syscalls/syscallStats.h>
+#include <kernel/utils/kprintf.h>
+
+namespace SyscallStats {
+
+static SyscallStatistics statistics[MAX_SYSCALLS];
+static uint32_t total = 0;
+
+/*
+ * Get the histogram bucket for the given latency
+ * Since buckets are powers of 2, the bucket is given by the position of the highest bit set
+ */
+static uint32_t latencyBucket(uint64_t cycles) {
+  uint32_t bucket = 0;
+
+  cycles >>= SYSCALL_LATENCY_FIRST_BUCKET_SHIFT;
+
+  while (cycles && bucket < SYSCALL_LATENCY_BUCKETS - 1) {
+    cycles >>= 1;
+    bucket++;
+  }
+
+  return bucket;
+}
+
+void record(uint32_t syscall, uint64_t cycles) {
+  if (syscall >= MAX_SYSCALLS) return;
+
+  SyscallStatistics *stats = &statistics[syscall];
+
+  if (!stats->calls || cycles < stats->minCycles) stats->minCycles = cycles;
+  if (cycles > stats->maxCycles) stats->maxCycles = cycles;
+
+  stats->calls++;
+  stats->totalCycles += cycles;
+  stats->histogram[latencyBucket(cycles)]++;
+
+  total++;
+}
+
+const SyscallStatistics& get(uint32_t syscall) {
+  return statistics[syscall];
+}
+
+uint32_t totalCalls() {
+  return total;
+}
+
+void dump() {
+  kprintf("\n=== Syscall statistics (%d calls) ===", total);
+
+  for (uint32_t i = 0; i < MAX_SYSCALLS; i++) {
+    SyscallStatistics *stats = &statistics[i];
+
+    if (!stats->calls) continue;
+
+    uint64_t average;
+    uint32_t remainder;
+    x86_div64_32(stats->totalCycles, stats->calls, &average, &remainder);
+
+    kprintf("\nSyscall %d: calls: %d, avg: %llu, min: %llu, max: %llu cycles", i, stats->calls, average, stats->minCycles, stats->maxCycles);
+
+    for (uint32_t bucket = 0; bucket < SYSCALL_LATENCY_BUCKETS; bucket++) {
+      if (!stats->histogram[bucket]) continue;
+
+      if (bucket == SYSCALL_LATENCY_BUCKETS - 1)
+        kprintf("\n  >= 2^%d cycles: %d", bucket + SYSCALL_LATENCY_FIRST_BUCKET_SHIFT - 1, stats->histogram[bucket]);
+      else
+        kprintf("\n  < 2^%d cycles: %d", bucket + SYSCALL_LATENCY_FIRST_BUCKET_SHIFT, stats->histogram[bucket]);
+    }
+  }
+
+  kprintf("\n");
+}
+
+}
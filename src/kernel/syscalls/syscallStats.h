@@ -0,0 +1,29 @@
+#pragma once
+#include <stdint.h>
+#include <syscallStatistics.h>
+
+#define MAX_SYSCALLS 32
+
+namespace SyscallStats {
+
+/*
+ * Record a call to the given syscall which took 'cycles' TSC cycles
+ */
+void record(uint32_t syscall, uint64_t cycles);
+
+/*
+ * Get the statistics recorded for the given syscall
+ */
+const SyscallStatistics& get(uint32_t syscall);
+
+/*
+ * Total number of syscalls invoked since boot
+ */
+uint32_t totalCalls();
+
+/*
+ * Print the statistics of every syscall invoked at least once
+ */
+void dump();
+
+}
@@ -1,81 +1,290 @@
 #include <stdint.h>
 #include <kernel/syscalls/syscalls.h>
 #include <syscallNumbers.h>
+#include <fileControl.h>
 #include <malloc.h>
+#include <string.h>
+#include <x86/x86.h>
+#include <kernel/syscalls/syscallStats.h>
+#include <kernel/fileSystem/BufferCache.h>
+#include <kernel/fileSystem/InodeCache.h>
+#include <kernel/fileSystem/FileMappings.h>
+#include <kernel/fileSystem/FileDescription.h>
+#include <kernel/fileSystem/FileDescriptorTable.h>
+#include <kernel/fileSystem/poll.h>
+#include <kernel/fileSystem/VirtualFileSystem.h>
 
 
-int32_t syscallTest(SyscallRegisters regs) {
-  return 10 + 20;
+SyscallResult syscallTest(const SyscallRegisters& regs) {
+  return syscallResult(10 + 20);
 }
 
-int32_t syscallMalloc(SyscallRegisters regs) {
+SyscallResult syscallMalloc(const SyscallRegisters& regs) {
   int32_t size = regs.ebx;
 
   void *ptr = mallocNextBlock(size);
 
-  asm volatile("mov %0, %%edx" : : "g"(ptr));
-
-  return EXIT_SUCCESS;
+  return syscallResult((uintptr_t)ptr);
 }
 
-int32_t syscallFree(SyscallRegisters regs) {
+SyscallResult syscallFree(const SyscallRegisters& regs) {
   void *ptr = (void *)regs.ebx;
 
   mallocFree(ptr);
 
-  return EXIT_SUCCESS;
+  return syscallResult(EXIT_SUCCESS);
+}
+
+/*
+ * Copy the statistics of the syscall in ebx into the SyscallStatistics pointed by ecx
+ */
+SyscallResult syscallStats(const SyscallRegisters& regs) {
+  uint32_t syscall = regs.ebx;
+  SyscallStatistics *destination = (SyscallStatistics *)regs.ecx;
+
+  if (syscall >= MAX_SYSCALLS || !destination) return syscallResult(EXIT_FAILURE);
+
+  memcpy(destination, (void *)&SyscallStats::get(syscall), sizeof(SyscallStatistics));
+
+  return syscallResult(EXIT_SUCCESS);
+}
+
+/*
+ * Write the modified inodes and every dirty block of the buffer cache back to the disk
+ */
+SyscallResult syscallSync(const SyscallRegisters& regs) {
+  InodeCache::instance().sync();
+  BufferCache::instance().sync();
+
+  return syscallResult(EXIT_SUCCESS);
+}
+
+/*
+ * Map the file at the path in ebx, starting at the page aligned offset in ecx, for edx bytes (0: up to the end of the file)
+ * The pages are read on the first access, returns the address of the mapping (0 on failure)
+ */
+SyscallResult syscallMmap(const SyscallRegisters& regs) {
+  const char *path = (const char *)regs.ebx;
+  uint32_t offset = regs.ecx;
+  uint32_t size = regs.edx;
+
+  if (!path) return syscallResult(0);
+
+  Inode *inode = VirtualFileSystem::instance().resolvePath(path);
+  if (!inode) return syscallResult(0);
+
+  if (!size && offset < inode->size()) size = inode->size() - offset;
+
+  VirtualAddress address = FileMappings::instance().map(*inode, offset, size);
+  if (!address) InodeCache::instance().release(inode);
+
+  return syscallResult(address);
+}
+
+/*
+ * Remove the mapping starting at the address in ebx
+ */
+SyscallResult syscallMunmap(const SyscallRegisters& regs) {
+  if (!FileMappings::instance().unmap(regs.ebx)) return syscallResult(EXIT_FAILURE);
+
+  return syscallResult(EXIT_SUCCESS);
+}
+
+/*
+ * Open the file at the path in ebx, returns its file descriptor (-1 on failure)
+ */
+SyscallResult syscallOpen(const SyscallRegisters& regs) {
+  const char *path = (const char *)regs.ebx;
+  if (!path) return syscallResult(EXIT_FAILURE);
+
+  Inode *inode = VirtualFileSystem::instance().resolvePath(path);
+  if (!inode) return syscallResult(EXIT_FAILURE);
+
+  // The description holds the inode reference from now on
+  FileDescription *description = FileDescription::create(*inode);
+
+  int32_t fd = FileDescriptorTable::current().allocate(*description);
+  if (fd < 0) description->close();
+
+  return syscallResult(fd);
+}
+
+SyscallResult syscallClose(const SyscallRegisters& regs) {
+  if (!FileDescriptorTable::current().close(regs.ebx)) return syscallResult(EXIT_FAILURE);
+
+  return syscallResult(EXIT_SUCCESS);
+}
+
+/*
+ * Read up to edx bytes into the buffer in ecx from the file descriptor in ebx, at its offset
+ * Returns the number of bytes read (-1 if the file descriptor isn't open)
+ */
+SyscallResult syscallRead(const SyscallRegisters& regs) {
+  FileDescription *description = FileDescriptorTable::current().get(regs.ebx);
+  if (!description || !regs.ecx) return syscallResult(EXIT_FAILURE);
+
+  return syscallResult(description->read((uint8_t *)regs.ecx, regs.edx));
+}
+
+SyscallResult syscallWrite(const SyscallRegisters& regs) {
+  FileDescription *description = FileDescriptorTable::current().get(regs.ebx);
+  if (!description || !regs.ecx) return syscallResult(EXIT_FAILURE);
+
+  return syscallResult(description->write((const uint8_t *)regs.ecx, regs.edx));
+}
+
+SyscallResult syscallDup(const SyscallRegisters& regs) {
+  return syscallResult(FileDescriptorTable::current().dup(regs.ebx));
+}
+
+/*
+ * Move up to edx bytes from the offset of the file descriptor in ecx to the one in ebx, inside the kernel
+ * Returns the number of bytes moved (-1 if one of the file descriptors isn't open)
+ */
+SyscallResult syscallSendFile(const SyscallRegisters& regs) {
+  FileDescription *destination = FileDescriptorTable::current().get(regs.ebx);
+  FileDescription *source = FileDescriptorTable::current().get(regs.ecx);
+  if (!destination || !source) return syscallResult(EXIT_FAILURE);
+
+  return syscallResult(source->sendFile(*destination, regs.edx));
+}
+
+/*
+ * Read or write the edx IOVectors in ecx in order, as a single transfer at the offset of the file descriptor in ebx
+ * Returns the total number of bytes transferred (-1 if the file descriptor isn't open)
+ */
+SyscallResult syscallReadv(const SyscallRegisters& regs) {
+  FileDescription *description = FileDescriptorTable::current().get(regs.ebx);
+  if (!description || (!regs.ecx && regs.edx)) return syscallResult(EXIT_FAILURE);
+
+  return syscallResult(description->readv((const IOVector *)regs.ecx, regs.edx));
+}
+
+SyscallResult syscallWritev(const SyscallRegisters& regs) {
+  FileDescription *description = FileDescriptorTable::current().get(regs.ebx);
+  if (!description || (!regs.ecx && regs.edx)) return syscallResult(EXIT_FAILURE);
+
+  return syscallResult(description->writev((const IOVector *)regs.ecx, regs.edx));
+}
+
+/*
+ * Read or write edx bytes with the buffer in ecx at the offset in esi of the file descriptor in ebx,
+ * without moving its offset
+ * Returns the number of bytes transferred (-1 if the file descriptor isn't open)
+ */
+SyscallResult syscallPread(const SyscallRegisters& regs) {
+  FileDescription *description = FileDescriptorTable::current().get(regs.ebx);
+  if (!description || !regs.ecx) return syscallResult(EXIT_FAILURE);
+
+  return syscallResult(description->pread((uint8_t *)regs.ecx, regs.edx, regs.esi));
+}
+
+SyscallResult syscallPwrite(const SyscallRegisters& regs) {
+  FileDescription *description = FileDescriptorTable::current().get(regs.ebx);
+  if (!description || !regs.ecx) return syscallResult(EXIT_FAILURE);
+
+  return syscallResult(description->pwrite((const uint8_t *)regs.ecx, regs.edx, regs.esi));
+}
+
+/*
+ * Wait until one of the ecx PollDescriptors in ebx is ready, or for edx milliseconds (-1: forever)
+ * Returns the number of ready descriptors
+ */
+SyscallResult syscallPoll(const SyscallRegisters& regs) {
+  PollDescriptor *descriptors = (PollDescriptor *)regs.ebx;
+  if (!descriptors && regs.ecx) return syscallResult(EXIT_FAILURE);
+
+  return syscallResult(Poll::poll(descriptors, regs.ecx, regs.edx));
+}
+
+/*
+ * Get (FCNTL_GET_FLAGS) or set (FCNTL_SET_FLAGS, to edx) the flags of the file descriptor in ebx, the command is in ecx
+ * Returns the flags for FCNTL_GET_FLAGS (-1 if the file descriptor isn't open or the command is unknown)
+ */
+SyscallResult syscallFcntl(const SyscallRegisters& regs) {
+  FileDescription *description = FileDescriptorTable::current().get(regs.ebx);
+  if (!description) return syscallResult(EXIT_FAILURE);
+
+  switch (regs.ecx) {
+    case FCNTL_GET_FLAGS:
+      return syscallResult(description->isNonBlocking() ? FCNTL_NON_BLOCKING : 0);
+    case FCNTL_SET_FLAGS:
+      description->setNonBlocking(regs.edx & FCNTL_NON_BLOCKING);
+      return syscallResult(EXIT_SUCCESS);
+    default:
+      return syscallResult(EXIT_FAILURE);
+  }
 }
 
 /*
  * Syscall table
  */
-int32_t (*syscalls[10])(SyscallRegisters) = {
+SyscallResult (*syscalls[MAX_SYSCALLS])(const SyscallRegisters&) = {
   [SYSCALL_TEST] = syscallTest,
   [SYSCALL_MALLOC] = syscallMalloc,
   [SYSCALL_FREE] = syscallFree,
+  [SYSCALL_STATS] = syscallStats,
+  [SYSCALL_SYNC] = syscallSync,
+  [SYSCALL_MMAP] = syscallMmap,
+  [SYSCALL_MUNMAP] = syscallMunmap,
+  [SYSCALL_SENDFILE] = syscallSendFile,
+  [SYSCALL_READV] = syscallReadv,
+  [SYSCALL_WRITEV] = syscallWritev,
+  [SYSCALL_PREAD] = syscallPread,
+  [SYSCALL_PWRITE] = syscallPwrite,
+  [SYSCALL_OPEN] = syscallOpen,
+  [SYSCALL_CLOSE] = syscallClose,
+  [SYSCALL_READ] = syscallRead,
+  [SYSCALL_WRITE] = syscallWrite,
+  [SYSCALL_DUP] = syscallDup,
+  [SYSCALL_POLL] = syscallPoll,
+  [SYSCALL_FCNTL] = syscallFcntl,
 };
 
+/*
+ * Called from the syscall dispatcher with the saved registers,
+ * call the requested syscall and record how long it took
+ * Interrupts are disabled here (interrupt gate), so the statistics can be updated safely
+ */
+extern "C" SyscallResult dispatchSyscall(const SyscallRegisters& regs) {
+  uint32_t syscall = regs.eax;
+
+  if (syscall >= MAX_SYSCALLS || !syscalls[syscall]) return syscallResult(EXIT_FAILURE);
+
+  uint64_t start = readTSC();
+  SyscallResult result = syscalls[syscall](regs);
+  SyscallStats::record(syscall, readTSC() - start);
+
+  return result;
+}
+
 __attribute__ ((naked)) void syscallDispatcher(IntFrame32 *frame) {
   asm volatile (".intel_syntax noprefix\n"
 
-                ".equ MAX_SYSCALLS, 10\n"     // Have to define again, inline asm does not see the #define
-
-                "cmp eax, MAX_SYSCALLS-1\n"   // syscalls table is 0-based
-                "ja invalid_syscall\n"        // invalid syscall number, skip and return
+                ".equ REGS_EDX, 8\n"          // Offset of edx within SyscallRegisters
+                ".equ REGS_EAX, 20\n"         // Offset of eax within SyscallRegisters
 
                 "push eax\n"
-                "push gs\n"
-                "push fs\n"
-                "push es\n"
-                "push ds\n"
-                "push ebp\n"
                 "push edi\n"
                 "push esi\n"
                 "push edx\n"
                 "push ecx\n"
                 "push ebx\n"
-                "push esp\n"
-                "call [syscalls + eax * 4]\n"
-                "add esp, 4\n"    // Do not overwrite esp
-                "pop ebx\n"
-                "pop ecx\n"
+                "push esp\n"                  // SyscallRegisters& (pointer to the registers just pushed)
+                "call dispatchSyscall\n"
+                "add esp, 4\n"
 
-                // Do not overwrite EDX, as some syscalls e.g. malloc() will need it
-                "add esp, 4\n"    
+                // Results come back in edx:eax, write them into the saved registers
+                "mov [esp + REGS_EAX], eax\n"
+                "mov [esp + REGS_EDX], edx\n"
 
+                "pop ebx\n"
+                "pop ecx\n"
+                "pop edx\n"
                 "pop esi\n"
                 "pop edi\n"
-                "pop ebp\n"
-                "pop ds\n"
-                "pop es\n"
-                "pop fs\n"
-                "pop gs\n"
-                "add esp, 4\n"    // Save eax value in case; don't overwrite it
+                "pop eax\n"
                 "iretd\n"         // Need interrupt return here! iret, NOT ret
 
-                "invalid_syscall:\n"
-                "mov eax, -1\n"   // Error will be -1
-                "iretd\n"
-
                 ".att_syntax");
-} 
+}
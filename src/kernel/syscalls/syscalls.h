@@ -3,37 +3,49 @@
 #include <kernel/interrupts/idt.h>
 
 #define EXIT_SUCCESS 0
+#define EXIT_FAILURE -1
 
 /*
- * Registers pushed onto stack when a syscall function is called
- * from the syscall dispatcher
+ * Registers pushed onto stack by the syscall dispatcher before calling a syscall function
+ * ebx, ecx, edx, esi and edi hold the syscall arguments, eax holds the syscall number
+ *
+ * Once the syscall returns, the dispatcher writes the results into the eax and edx slots,
+ * then pops everything back, so the caller gets the results in those registers
  */
 typedef struct {
-    uint32_t esp;
     uint32_t ebx;
     uint32_t ecx;
     uint32_t edx;
     uint32_t esi;
     uint32_t edi;
-    uint32_t ebp;
-    uint32_t ds;
-    uint32_t es;
-    uint32_t fs;
-    uint32_t gs;
     uint32_t eax;
 } __attribute__ ((packed)) SyscallRegisters;
 
+/*
+ * Value returned by every syscall function
+ * Returned as a 64 bit value so the compiler puts it in edx:eax (cdecl),
+ * the low 32 bits are the main result (eax) and the high 32 bits an optional second result (edx)
+ */
+typedef uint64_t SyscallResult;
+
+/*
+ * Build the result of a syscall from its main result (eax) and its optional second result (edx)
+ */
+static inline SyscallResult syscallResult(uint32_t value, uint32_t extra = 0) {
+  return ((uint64_t)extra << 32) | value;
+}
 
 /*
  * Syscall dispatcher, called when a syscall is invoked
  * "naked" means: do not add function epilogue/prologue, and only allow inline asm
  *
- * Push everything we want to save
- * Call the syscall by offseting into the syscall table by using the value in eax
+ * Push the arguments (BX, CX, DX, SI, DI) and the syscall number (AX)
+ * Call dispatchSyscall, which looks up the syscall table using the saved AX and records its statistics
+ * Write the results (edx:eax) into the saved AX and DX
  * Pop everything back
  * Return using "iret" since it's an interrupt (software interrupt)
  *
  * Already on stack: SS, SP, FLAGS, CS, IP
- * Need to push: AX, GS, FS, ES, DS, BP, DI, SI, DX, CX, BX
+ * BP, BX, SI, DI are callee-saved (cdecl), so only CX needs to be saved on top of the arguments
  */
-__attribute__ ((naked)) void syscallDispatcher(IntFrame32 *frame); 
+__attribute__ ((naked)) void syscallDispatcher(IntFrame32 *frame);
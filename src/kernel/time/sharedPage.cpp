@@ -0,0 +1,56 @@
+#include <stdint.h>
+#include <x86/x86.h>
+#include <virtualMem.h>
+#include <memLayout.h>
+#include <kernel/time/sharedPage.h>
+#include <kernel/syscalls/syscallStats.h>
+
+namespace SharedPage {
+
+/*
+ * The shared page takes a whole page so nothing else of the kernel gets exposed when mapping it to user space
+ */
+static union {
+  SharedPageData data;
+  uint8_t bytes[PAGE_SIZE];
+} page __attribute__ ((aligned(PAGE_SIZE)));
+
+void initialize(uint32_t tickFrequency) {
+  page.data.tickFrequency = tickFrequency;
+  page.data.tickPeriodMicroseconds = 1000000 / tickFrequency;
+
+  // The kernel is linked at KERNEL_BASE + physical address, so the page frame is its virtual address - KERNEL_BASE
+  PhysicalAddress frame = (PhysicalAddress)V2P(&page);
+
+  // Present, user, read-only
+  mapPageWithAttributes(SHARED_PAGE_USER_ADDRESS, frame, PTE_USER);
+}
+
+void onTick() {
+  SharedPageData *data = &page.data;
+  uint64_t tsc = readTSC();
+
+  // Odd sequence: readers will retry until we finish
+  data->sequence++;
+  asm volatile("" : : : "memory");
+
+  // Calibrate the TSC using the time between two ticks,
+  // smoothing with the previous value to absorb the IRQ latency jitter
+  if (data->ticks) {
+    uint64_t cycles = tsc - data->tscAtLastTick;
+    data->tscPerTick = data->tscPerTick ? (data->tscPerTick * 7 + cycles) >> 3 : cycles;
+  }
+
+  data->ticks++;
+  data->tscAtLastTick = tsc;
+  data->syscalls = SyscallStats::totalCalls();
+
+  asm volatile("" : : : "memory");
+  data->sequence++;
+}
+
+const SharedPageData& data() {
+  return page.data;
+}
+
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include <stdint.h>
+#include <sharedPageData.h>
+
+namespace SharedPage {
+
+/*
+ * Map the shared page read-only at SHARED_PAGE_USER_ADDRESS in the current address space
+ * 'tickFrequency' is the frequency the PIT was configured with
+ */
+void initialize(uint32_t tickFrequency);
+
+/*
+ * Update the shared page, called on every PIT tick (IRQ 0)
+ */
+void onTick();
+
+/*
+ * Kernel view of the shared page
+ */
+const SharedPageData& data();
+
+}
@@ -7,7 +7,7 @@ void TTY::setSize(uint8_t rows, uint8_t columns) {
 }
 
 bool TTY::canRead(FileDescription&) const {
-  return true;
+  return !_input_buffer.empty();
 }
 
 size_t TTY::read(FileDescription&, uint8_t *buffer, size_t size) {
@@ -19,8 +19,24 @@ size_t TTY::read(FileDescription&, uint8_t *buffer, size_t size) {
   return size;
 }
 
+size_t TTY::readv(FileDescription&, const IOVector *vectors, uint32_t count) {
+  size_t transferred = 0;
+
+  for (uint32_t i = 0; i < count && _input_buffer.size(); i++) {
+    size_t size = vectors[i].length;
+    if (size > _input_buffer.size()) size = _input_buffer.size();
+
+    for (size_t j = 0; j < size; j++)
+      vectors[i].base[j] = _input_buffer.dequeue();
+
+    transferred += size;
+  }
+
+  return transferred;
+}
+
 bool TTY::canWrite(FileDescription&) const {
-  return false;
+  return true;
 }
 
 size_t TTY::write(FileDescription&, const uint8_t *buffer, size_t size) {
@@ -30,4 +46,5 @@ size_t TTY::write(FileDescription&, const uint8_t *buffer, size_t size) {
 void TTY::emit(uint8_t ch) {
   // TODO: handle events like Ctrl + W for erasing word
   _input_buffer.enqueue(ch);
+  _waitQueue.wakeAll();
 }
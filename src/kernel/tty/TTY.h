@@ -13,6 +13,11 @@ class TTY : public CharacterDevice {
     virtual size_t read(FileDescription&, uint8_t*, size_t) override;
     virtual size_t write(FileDescription&, const uint8_t*, size_t) override;
 
+    /*
+     * Fill the buffers in order from the input buffer, in a single pass
+     */
+    virtual size_t readv(FileDescription&, const IOVector*, uint32_t count) override;
+
     virtual bool isTTY() const final override { return true; } 
 
     void setSize(uint8_t rows, uint8_t columns);
@@ -0,0 +1,30 @@
+#pragma once
+#include <stdint.h>
+
+/*
+ * Event that can be waited for, woken up by whoever makes it happen (usually an IRQ handler)
+ * There is a single flow of control, so waiting halts the CPU until an interrupt wakes the queue up
+ *
+ * Waiters take a snapshot of the wake up count before checking their condition, then sleep until it changes,
+ * so a wake up that happens in between isn't missed
+ */
+class WaitQueue {
+  public:
+    /*
+     * Wake up everything waiting on the queue, safe to call from an IRQ handler
+     */
+    void wakeAll() { _wakeUps++; }
+
+    uint32_t wakeUps() const { return _wakeUps; }
+
+    /*
+     * Halt until the queue is woken up after the given snapshot
+     * Must be called with interrupts disabled, they are disabled again on return
+     */
+    void wait(uint32_t snapshot) const {
+      while (_wakeUps == snapshot) asm volatile("sti\n hlt\n cli");
+    }
+
+  private:
+    volatile uint32_t _wakeUps { 0 };
+};
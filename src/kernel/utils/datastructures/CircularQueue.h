@@ -77,15 +77,15 @@ class CircularQueue {
       }
     }
     
-    bool full() {
+    bool full() const {
         return _size == capacity;
     }
     
-    bool empty() {
+    bool empty() const {
         return _size == 0;
     }
     
-    int size() {
+    int size() const {
         return _size;
     }
 
@@ -5,7 +5,7 @@
 #include <mem.h>
 #include <stdio.h>
 #include <kernel/fileSystem/fs.h>
-#include <kernel/fileSystem/VirtualFileSystem.h>
+#include <kernel/devices/ATA.h>
 
 #define SECTOR_SIZE 512
 #define PAGE_SIZE 4096
@@ -31,8 +31,11 @@ __attribute__ ((section ("prekernel_entry"))) void loadOS() {
   uint8_t tmp[SECTOR_SIZE];
   struct superBlock superblock;
 
+  // Enable READ MULTIPLE (if supported) before loading the kernel
+  ATA::initializePolling();
+
   // Read the first sector of the super block, right after the boot block
-  VirtualFileSystem::readSector(tmp, 1 * 8);
+  ATA::readSectors(tmp, 1 * 8, 1);
   memcpy(&superblock, tmp, sizeof(struct superBlock));
 
   printf("SuperBlock Info:\n");
@@ -44,7 +47,7 @@ __attribute__ ((section ("prekernel_entry"))) void loadOS() {
 
   struct inode inodes[4];
 
-  VirtualFileSystem::readSector(tmp, superblock.firstInodeBlock * 8);
+  ATA::readSectors(tmp, superblock.firstInodeBlock * 8, 1);
   memcpy(&inodes, tmp, sizeof(struct inode) * 4);
 
   struct inode rootDirectoryInode = inodes[1];
@@ -58,7 +61,7 @@ __attribute__ ((section ("prekernel_entry"))) void loadOS() {
 
   struct directoryEntry rootDirectoryEntries[4];
 
-  VirtualFileSystem::readSector(tmp, rootDirectoryInode.directDataBlocks[0] * 8);
+  ATA::readSectors(tmp, rootDirectoryInode.directDataBlocks[0] * 8, 1);
   memcpy(&rootDirectoryEntries, tmp, sizeof(rootDirectoryEntries));
 
   printf("\nRoot directory content: \n");
@@ -82,17 +85,22 @@ __attribute__ ((section ("prekernel_entry"))) void loadOS() {
 
 
   struct inode kernelInode;
-  VirtualFileSystem::readSector(tmp, sectorToLoad);
+  ATA::readSectors(tmp, sectorToLoad, 1);
   memcpy(&kernelInode, tmp, sizeof(struct inode));
 
   printf("\nKernel inode\n");
   printf("number: %d\n", kernelInode.number);
-  printf("first direct dataBlock: %d\n", kernelInode.directDataBlocks[0]);
   printf("type: %s\n", kernelInode.type ? "directory" : "file");
   printf("sizeInBytes: %d\n", kernelInode.sizeInBytes);
   printf("sizeInSectors: %d\n", kernelInode.sizeInSectors);
 
-  kernelELFDiskOffset = kernelInode.directDataBlocks[0] * PAGE_SIZE;
+  // The kernel is contiguous on disk, makeImage maps it with a single extent
+  uint32_t kernelFirstBlock = kernelInode.directDataBlocks[0];
+  if (kernelInode.flags & INODE_FLAG_EXTENTS)
+    kernelFirstBlock = ((struct extent *)(kernelInode.extentRoot + sizeof(struct extentHeader)))->startBlock;
+
+  printf("first dataBlock: %d\n", kernelFirstBlock);
+  kernelELFDiskOffset = kernelFirstBlock * PAGE_SIZE;
 
   // Load 4096 bytes from hard disk address KERNEL_ELF_DISK_OFFSET into 0x10_000
   readSegment((uint8_t *)elf, PAGE_SIZE, 0);
@@ -160,7 +168,7 @@ void readSegment(uint8_t *destination, uint32_t bytes, uint32_t address) {
   // will point to 0x0 but the 'destination' in the caller will point to 0xC8 as we wanted
   destination -= address % SECTOR_SIZE;
   
-  // Read sectors until filling the requested bytes amount
-  for (; destination < endDestination; destination += SECTOR_SIZE, sector++)
-    VirtualFileSystem::readSector(destination, sector);
+  // Read all the sectors needed to fill the requested bytes amount at once
+  uint32_t sectors = (endDestination - destination + SECTOR_SIZE - 1) / SECTOR_SIZE;
+  ATA::readSectors(destination, sector, sectors);
 }